@@ -0,0 +1,135 @@
+#include "asset_loader.h"
+#include <SDL2/SDL_image.h>
+#include "snake_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool decodeAsset(Asset *asset) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool ok = false;
+    switch (asset->kind) {
+        case ASSET_IMAGE: {
+            SDL_Surface *loaded = IMG_Load(asset->path);
+            if (!loaded) {
+                printf("Unable to load image %s! SDL_image Error: %s\n", asset->path, IMG_GetError());
+                break;
+            }
+            asset->surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(loaded);
+            if (!asset->surface) {
+                printf("Unable to convert image %s! SDL Error: %s\n", asset->path, SDL_GetError());
+            }
+            ok = asset->surface != NULL;
+            break;
+        }
+        case ASSET_CHUNK:
+            asset->chunk = Mix_LoadWAV(asset->path);
+            if (!asset->chunk) {
+                printf("Failed to load sound %s! SDL_mixer Error: %s\n", asset->path, Mix_GetError());
+            }
+            ok = asset->chunk != NULL;
+            break;
+        case ASSET_PCM:
+            ok = decodeMixerSound(&asset->pcm, asset->path);
+            break;
+        case ASSET_FONT:
+            asset->font = TTF_OpenFont(asset->path, asset->fontSize);
+            if (!asset->font) {
+                printf("Failed to load font %s! SDL_ttf Error: %s\n", asset->path, TTF_GetError());
+            }
+            ok = asset->font != NULL;
+            break;
+    }
+    asset->decodeTime = SDL_GetPerformanceCounter() - start;
+    return ok;
+}
+
+// Claims assets one at a time until none are left, so a slow decode never
+// holds up the assets queued behind it.
+static void *decodeAssets(void *arg) {
+    AssetLoader *loader = arg;
+    for (;;) {
+        pthread_mutex_lock(&loader->lock);
+        int index = loader->next < loader->count ? loader->next++ : -1;
+        pthread_mutex_unlock(&loader->lock);
+        if (index < 0) {
+            return NULL;
+        }
+        if (!decodeAsset(&loader->assets[index])) {
+            pthread_mutex_lock(&loader->lock);
+            loader->failed = true;
+            pthread_mutex_unlock(&loader->lock);
+        }
+    }
+}
+
+// threads <= 0 uses one thread per core, never more than one per asset.
+// Image, TTF and mixer libraries must already be initialized.
+bool startAssetLoader(AssetLoader *loader, Asset *assets, int count, int threads) {
+    memset(loader, 0, sizeof(*loader));
+    loader->assets = assets;
+    loader->count = count;
+    loader->start = SDL_GetPerformanceCounter();
+    pthread_mutex_init(&loader->lock, NULL);
+    threads = threads > 0 ? threads : snakeDefaultThreadCount();
+    threads = threads < count ? threads : count;
+    loader->threads = malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+    if (!loader->threads) {
+        // finishAssetLoader() decodes everything on the calling thread instead
+        return true;
+    }
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&loader->threads[i], NULL, decodeAssets, loader) != 0) {
+            break;
+        }
+        loader->threadCount++;
+    }
+    return true;
+}
+
+// Helps with whatever is still queued, then waits for the workers. Returns
+// false if any asset failed to decode; the error has been printed already.
+bool finishAssetLoader(AssetLoader *loader) {
+    decodeAssets(loader);
+    for (int i = 0; i < loader->threadCount; i++) {
+        pthread_join(loader->threads[i], NULL);
+    }
+    free(loader->threads);
+    loader->threads = NULL;
+    pthread_mutex_destroy(&loader->lock);
+    loader->elapsed = SDL_GetPerformanceCounter() - loader->start;
+    return !loader->failed;
+}
+
+// Frees whatever decoded data is still owned by the assets.
+void freeAssets(Asset *assets, int count) {
+    for (int i = 0; i < count; i++) {
+        SDL_FreeSurface(assets[i].surface);
+        Mix_FreeChunk(assets[i].chunk);
+        SDL_free(assets[i].pcm.pcm);
+        if (assets[i].font) TTF_CloseFont(assets[i].font);
+        assets[i].surface = NULL;
+        assets[i].chunk = NULL;
+        assets[i].pcm = (MixerSound){NULL, 0};
+        assets[i].font = NULL;
+    }
+}
+
+void reportAssets(const AssetLoader *loader) {
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    Uint64 decoding = 0;
+    for (int i = 0; i < loader->count; i++) {
+        decoding += loader->assets[i].decodeTime;
+    }
+    printf("Assets: %d decoded on %d threads in %.2f ms, %.2f ms of decoding\n", loader->count,
+           loader->threadCount > 0 ? loader->threadCount : 1, loader->elapsed * toMs, decoding * toMs);
+    for (int i = 0; i < loader->count; i++) {
+        const Asset *asset = &loader->assets[i];
+        if (asset->uploadTime) {
+            printf("  %-56s decode %7.2f ms, upload %6.2f ms\n", asset->path, asset->decodeTime * toMs, asset->uploadTime * toMs);
+        } else {
+            printf("  %-56s decode %7.2f ms\n", asset->path, asset->decodeTime * toMs);
+        }
+    }
+}
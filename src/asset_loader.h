@@ -0,0 +1,51 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+// Decodes startup assets on worker threads while the caller gets on with
+// creating the window and renderer. Only decoding happens here: anything
+// that needs the renderer is uploaded by the caller afterwards, on its own
+// thread.
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_ttf.h>
+#include <pthread.h>
+#include "audio_mixer.h"
+
+typedef enum {
+    ASSET_IMAGE,         // decoded and converted to ARGB8888
+    ASSET_CHUNK,         // SDL_mixer chunk, needs Mix_OpenAudio first
+    ASSET_PCM,           // PCM for the custom audio mixer
+    ASSET_FONT
+} AssetKind;
+
+typedef struct {
+    AssetKind kind;
+    const char *path;
+    int fontSize;        // ASSET_FONT only
+    SDL_Surface *surface;
+    Mix_Chunk *chunk;
+    MixerSound pcm;
+    TTF_Font *font;
+    Uint64 decodeTime;
+    Uint64 uploadTime;   // filled in by the caller for assets it uploads
+} Asset;
+
+typedef struct {
+    Asset *assets;
+    int count;
+    int next;            // first asset no thread has claimed yet
+    bool failed;
+    pthread_mutex_t lock;
+    pthread_t *threads;
+    int threadCount;
+    Uint64 start;
+    Uint64 elapsed;      // from start until every asset was decoded
+} AssetLoader;
+
+bool startAssetLoader(AssetLoader *loader, Asset *assets, int count, int threads);
+bool finishAssetLoader(AssetLoader *loader);
+void freeAssets(Asset *assets, int count);
+void reportAssets(const AssetLoader *loader);
+
+#endif // ASSET_LOADER_H
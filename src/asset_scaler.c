@@ -0,0 +1,52 @@
+#include "asset_scaler.h"
+#include <stdio.h>
+#include <string.h>
+
+static void *scaleAssets(void *arg) {
+    AssetScaler *scaler = arg;
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (scaler->boardWidth > 0 && scaler->boardHeight > 0) {
+        scaler->background = resampleSurface(scaler->backgroundSource, scaler->boardWidth * scaler->cellSize,
+                                             scaler->boardHeight * scaler->cellSize);
+    }
+    scaler->spriteSheet = buildSpriteSheet(scaler->atlas, scaler->cellSize);
+    scaler->elapsed = SDL_GetPerformanceCounter() - start;
+    SDL_AtomicSet(&scaler->finished, 1);
+
+    // Wake a render loop that is blocked waiting for input
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    SDL_PushEvent(&event);
+    return NULL;
+}
+
+bool startAssetScaler(AssetScaler *scaler, SDL_Surface *backgroundSource, const SpriteAtlas *atlas,
+                      int boardWidth, int boardHeight, int cellSize) {
+    scaler->backgroundSource = backgroundSource;
+    scaler->atlas = atlas;
+    scaler->boardWidth = boardWidth;
+    scaler->boardHeight = boardHeight;
+    scaler->cellSize = cellSize;
+    scaler->background = NULL;
+    scaler->spriteSheet = NULL;
+    SDL_AtomicSet(&scaler->finished, 0);
+    if (pthread_create(&scaler->thread, NULL, scaleAssets, scaler) != 0) {
+        printf("Unable to start asset scaling thread!\n");
+        return false;
+    }
+    scaler->running = true;
+    return true;
+}
+
+bool assetScalerFinished(AssetScaler *scaler) {
+    return scaler->running && SDL_AtomicGet(&scaler->finished);
+}
+
+// Waits for the job; its results are then left in background and spriteSheet.
+void finishAssetScaler(AssetScaler *scaler) {
+    if (scaler->running) {
+        pthread_join(scaler->thread, NULL);
+        scaler->running = false;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef ASSET_SCALER_H
+#define ASSET_SCALER_H
+
+// Resamples the background and the sprite sheet for a new cell size on a
+// worker thread. The render thread only uploads the finished surfaces, so
+// a window resize never stalls a frame on filtering.
+
+#include <SDL2/SDL.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include "sprite_atlas.h"
+
+typedef struct {
+    pthread_t thread;
+    bool running;               // started and not yet collected
+    SDL_atomic_t finished;
+    int cellSize;               // cell size of the job
+    int boardWidth;             // in cells, 0 keeps the current background
+    int boardHeight;
+    SDL_Surface *backgroundSource;
+    const SpriteAtlas *atlas;
+    SDL_Surface *background;    // results, owned by the caller once collected
+    SDL_Surface *spriteSheet;
+    Uint64 elapsed;             // performance counter units the job took
+} AssetScaler;
+
+bool startAssetScaler(AssetScaler *scaler, SDL_Surface *backgroundSource, const SpriteAtlas *atlas,
+                      int boardWidth, int boardHeight, int cellSize);
+bool assetScalerFinished(AssetScaler *scaler);
+void finishAssetScaler(AssetScaler *scaler);
+
+#endif // ASSET_SCALER_H
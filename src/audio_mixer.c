@@ -0,0 +1,278 @@
+#include "audio_mixer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AUDIO_MIXER_X86 1
+#include <immintrin.h>
+#endif
+
+static void mixScalar(int16_t *out, const int16_t *in, int count) {
+    for (int i = 0; i < count; i++) {
+        int sum = out[i] + in[i];
+        out[i] = sum > INT16_MAX ? INT16_MAX : sum < INT16_MIN ? INT16_MIN : sum;
+    }
+}
+
+#ifdef AUDIO_MIXER_X86
+// Saturating 16-bit adds clamp each lane exactly like mixScalar()
+__attribute__((target("sse2")))
+static void mixSse(int16_t *out, const int16_t *in, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i sum = _mm_adds_epi16(_mm_loadu_si128((const __m128i *)(out + i)), _mm_loadu_si128((const __m128i *)(in + i)));
+        _mm_storeu_si128((__m128i *)(out + i), sum);
+    }
+    mixScalar(out + i, in + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void mixAvx2(int16_t *out, const int16_t *in, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i sum = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i *)(out + i)), _mm256_loadu_si256((const __m256i *)(in + i)));
+        _mm256_storeu_si256((__m256i *)(out + i), sum);
+    }
+    mixSse(out + i, in + i, count - i);
+}
+#endif
+
+MixKernel mixerBestKernel(void) {
+#ifdef AUDIO_MIXER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return MIX_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return MIX_KERNEL_SSE;
+    }
+#endif
+    return MIX_KERNEL_SCALAR;
+}
+
+// Takes a free voice, or steals the one started longest ago.
+static void startVoice(AudioMixer *mixer, SoundId sound) {
+    MixerVoice *voice = &mixer->voices[0];
+    for (int i = 0; i < MIXER_VOICES; i++) {
+        MixerVoice *candidate = &mixer->voices[i];
+        if (!candidate->active) {
+            voice = candidate;
+            break;
+        }
+        if (candidate->serial < voice->serial) voice = candidate;
+    }
+    if (voice->active) {
+        atomic_fetch_add_explicit(&mixer->stolen, 1, memory_order_relaxed);
+    }
+    *voice = (MixerVoice){true, sound, 0, mixer->nextSerial++};
+}
+
+// Mixes every active voice into frames of interleaved stereo.
+static void mixVoices(AudioMixer *mixer, int16_t *out, int frames) {
+    void (*mix)(int16_t *, const int16_t *, int) = mixScalar;
+#ifdef AUDIO_MIXER_X86
+    if (mixer->kernel == MIX_KERNEL_AVX2) mix = mixAvx2;
+    if (mixer->kernel == MIX_KERNEL_SSE) mix = mixSse;
+#endif
+    // Silence is all zero bits for signed 16-bit samples
+    memset(out, 0, (size_t)frames * 2 * sizeof(int16_t));
+    for (int i = 0; i < MIXER_VOICES; i++) {
+        MixerVoice *voice = &mixer->voices[i];
+        if (!voice->active) {
+            continue;
+        }
+        const MixerSound *sound = &mixer->sounds[voice->sound];
+        int count = sound->frames - voice->position;
+        if (count > frames) count = frames;
+        mix(out, sound->pcm + (size_t)voice->position * 2, count * 2);
+        voice->position += count;
+        voice->active = voice->position < sound->frames;
+    }
+}
+
+static void SDLCALL mixerCallback(void *userdata, Uint8 *stream, int length) {
+    AudioMixer *mixer = userdata;
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool late = mixer->lastCallback && start - mixer->lastCallback > 2 * mixer->period;
+    mixer->lastCallback = start;
+
+    unsigned tail = atomic_load_explicit(&mixer->requestTail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&mixer->requestHead, memory_order_acquire);
+    for (; tail != head; tail++) {
+        startVoice(mixer, mixer->requests[tail % MIXER_REQUESTS]);
+    }
+    atomic_store_explicit(&mixer->requestTail, tail, memory_order_release);
+
+    mixVoices(mixer, (int16_t *)stream, length / (int)(2 * sizeof(int16_t)));
+
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    atomic_fetch_add_explicit(&mixer->callbacks, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&mixer->busy, elapsed, memory_order_relaxed);
+    if (elapsed > atomic_load_explicit(&mixer->slowest, memory_order_relaxed)) {
+        atomic_store_explicit(&mixer->slowest, elapsed, memory_order_relaxed);
+    }
+    if (late || elapsed > mixer->period) {
+        atomic_fetch_add_explicit(&mixer->underruns, 1, memory_order_relaxed);
+    }
+}
+
+// Decodes a WAV file into the mixer's own format once, up front. Touches no
+// mixer state, so any thread may call it.
+bool decodeMixerSound(MixerSound *sound, const char *path) {
+    SDL_AudioSpec spec;
+    Uint8 *data;
+    Uint32 length;
+    if (!SDL_LoadWAV(path, &spec, &data, &length)) {
+        printf("Failed to load sound %s! SDL Error: %s\n", path, SDL_GetError());
+        return false;
+    }
+    SDL_AudioCVT cvt;
+    if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, 2, MIXER_FREQUENCY) < 0) {
+        printf("Unable to convert sound %s! SDL Error: %s\n", path, SDL_GetError());
+        SDL_FreeWAV(data);
+        return false;
+    }
+    cvt.len = (int)length;
+    cvt.buf = SDL_malloc((size_t)length * cvt.len_mult);
+    if (!cvt.buf) {
+        SDL_FreeWAV(data);
+        return false;
+    }
+    memcpy(cvt.buf, data, length);
+    SDL_FreeWAV(data);
+    if (SDL_ConvertAudio(&cvt) < 0) {
+        printf("Unable to convert sound %s! SDL Error: %s\n", path, SDL_GetError());
+        SDL_free(cvt.buf);
+        return false;
+    }
+    sound->pcm = (int16_t *)cvt.buf;
+    sound->frames = cvt.len_cvt / (int)(2 * sizeof(int16_t));
+    return true;
+}
+
+// Decodes every sound and picks a kernel without opening a device, for
+// renderAudioOffline().
+bool openOfflineMixer(AudioMixer *mixer, const char *paths[SOUND_COUNT]) {
+    memset(mixer, 0, sizeof(*mixer));
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        if (!decodeMixerSound(&mixer->sounds[i], paths[i])) {
+            closeAudioMixer(mixer);
+            return false;
+        }
+    }
+    mixer->kernel = mixerBestKernel();
+    return true;
+}
+
+// Takes ownership of sounds from decodeMixerSound(), even on failure.
+// samples is the device buffer in frames, clamped to [MIXER_MIN_SAMPLES, MIXER_MAX_SAMPLES].
+bool openAudioMixer(AudioMixer *mixer, const MixerSound sounds[SOUND_COUNT], int samples) {
+    if (samples < MIXER_MIN_SAMPLES) samples = MIXER_MIN_SAMPLES;
+    if (samples > MIXER_MAX_SAMPLES) samples = MIXER_MAX_SAMPLES;
+    memset(mixer, 0, sizeof(*mixer));
+    memcpy(mixer->sounds, sounds, sizeof(mixer->sounds));
+    mixer->kernel = mixerBestKernel();
+    SDL_AudioSpec want = {0};
+    want.freq = MIXER_FREQUENCY;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = (Uint16)samples;
+    want.callback = mixerCallback;
+    want.userdata = mixer;
+    SDL_AudioSpec have;
+    // Take the device's nearest buffer size instead of SDL reblocking behind it, and report what we got
+    mixer->device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    if (mixer->device == 0) {
+        printf("Unable to open audio device! SDL Error: %s\n", SDL_GetError());
+        closeAudioMixer(mixer);
+        return false;
+    }
+    mixer->samples = have.samples;
+    mixer->period = SDL_GetPerformanceFrequency() * have.samples / MIXER_FREQUENCY;
+    static const char *kernels[] = {"scalar", "SSE2", "AVX2"};
+    printf("Audio mixer: %d-sample buffers (%.1f ms), %s kernel\n", mixer->samples,
+           mixer->samples * 1000.0 / MIXER_FREQUENCY, kernels[mixer->kernel]);
+    SDL_PauseAudioDevice(mixer->device, 0);
+    return true;
+}
+
+void closeAudioMixer(AudioMixer *mixer) {
+    if (mixer->device) {
+        SDL_CloseAudioDevice(mixer->device);
+    }
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        SDL_free(mixer->sounds[i].pcm);
+    }
+    memset(mixer, 0, sizeof(*mixer));
+}
+
+// Never blocks: a full request ring drops the sound and counts it.
+void mixerPlay(AudioMixer *mixer, SoundId sound) {
+    if (!mixer->device) {
+        return;
+    }
+    unsigned head = atomic_load_explicit(&mixer->requestHead, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&mixer->requestTail, memory_order_acquire);
+    if (head - tail == MIXER_REQUESTS) {
+        atomic_fetch_add_explicit(&mixer->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    mixer->requests[head % MIXER_REQUESTS] = sound;
+    atomic_store_explicit(&mixer->requestHead, head + 1, memory_order_release);
+}
+
+void reportAudioMixer(AudioMixer *mixer) {
+    unsigned long callbacks = atomic_load(&mixer->callbacks);
+    if (!mixer->device || callbacks == 0) {
+        return;
+    }
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    printf("Audio callback: %lu calls, %.3f ms avg, %.3f ms max of %.2f ms budget, %lu underruns, %lu stolen, %lu dropped\n",
+           callbacks, atomic_load(&mixer->busy) * toMs / callbacks, atomic_load(&mixer->slowest) * toMs,
+           mixer->period * toMs, atomic_load(&mixer->underruns), atomic_load(&mixer->stolen), atomic_load(&mixer->dropped));
+}
+
+// Renders a timeline sorted by frame into frames of interleaved stereo, as
+// fast as the CPU allows. Every sound starts on exactly its frame and voices
+// are assigned in timeline order, so the output depends only on the
+// timeline, never on the kernel or on timing. Must not be used on a mixer
+// with an open device. The caller frees the result.
+int16_t *renderAudioOffline(AudioMixer *mixer, const TimedSound *timeline, int count, int frames) {
+    int16_t *pcm = frames > 0 ? malloc((size_t)frames * 2 * sizeof(int16_t)) : NULL;
+    if (!pcm) {
+        return NULL;
+    }
+    memset(mixer->voices, 0, sizeof(mixer->voices));
+    mixer->nextSerial = 0;
+    int next = 0;
+    for (int frame = 0; frame < frames;) {
+        while (next < count && timeline[next].frame <= frame) {
+            startVoice(mixer, timeline[next++].sound);
+        }
+        int end = frame + MIXER_MAX_SAMPLES;
+        if (end > frames) end = frames;
+        if (next < count && timeline[next].frame < end) end = timeline[next].frame;
+        mixVoices(mixer, pcm + (size_t)frame * 2, end - frame);
+        frame = end;
+    }
+    return pcm;
+}
+
+// Writes 16-bit stereo PCM as a WAV file, to disk or to memory.
+bool writeWav(SDL_RWops *out, const int16_t *pcm, int frames) {
+    Uint32 bytes = (Uint32)frames * 2 * sizeof(int16_t);
+    bool ok = SDL_RWwrite(out, "RIFF", 4, 1) && SDL_WriteLE32(out, 36 + bytes) && SDL_RWwrite(out, "WAVEfmt ", 8, 1) &&
+              SDL_WriteLE32(out, 16) && SDL_WriteLE16(out, 1) && SDL_WriteLE16(out, 2) &&
+              SDL_WriteLE32(out, MIXER_FREQUENCY) && SDL_WriteLE32(out, MIXER_FREQUENCY * 2 * sizeof(int16_t)) &&
+              SDL_WriteLE16(out, 2 * sizeof(int16_t)) && SDL_WriteLE16(out, 16) &&
+              SDL_RWwrite(out, "data", 4, 1) && SDL_WriteLE32(out, bytes);
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    ok = ok && (bytes == 0 || SDL_RWwrite(out, pcm, bytes, 1) == 1);
+#else
+    for (int i = 0; ok && i < frames * 2; i++) {
+        ok = SDL_WriteLE16(out, (Uint16)pcm[i]);
+    }
+#endif
+    return ok;
+}
@@ -0,0 +1,78 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+// Optional low-latency audio backend: our own SDL audio callback mixing a
+// fixed pool of voices over pre-decoded 16-bit stereo PCM. The game thread
+// only drops sound IDs into a lock-free ring, the callback starts and mixes
+// the voices with saturating SIMD adds and keeps timing stats. The same
+// mixing also renders event timelines offline, without any device.
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "sound_bank.h"
+
+#define MIXER_FREQUENCY 44100
+#define MIXER_MIN_SAMPLES 128
+#define MIXER_MAX_SAMPLES 512
+#define MIXER_VOICES 16
+#define MIXER_REQUESTS 64    // power of two
+
+typedef enum {
+    MIX_KERNEL_SCALAR,
+    MIX_KERNEL_SSE,
+    MIX_KERNEL_AVX2
+} MixKernel;
+
+// A sound starting on a given frame of an offline render
+typedef struct {
+    int frame;
+    SoundId sound;
+} TimedSound;
+
+typedef struct {
+    int16_t *pcm;        // interleaved stereo at MIXER_FREQUENCY
+    int frames;
+} MixerSound;
+
+// Owned by the callback thread
+typedef struct {
+    bool active;
+    SoundId sound;
+    int position;        // next frame to mix
+    unsigned long serial; // start order, the lowest is stolen first
+} MixerVoice;
+
+typedef struct {
+    SDL_AudioDeviceID device;
+    int samples;         // frames per callback
+    Uint64 period;       // one buffer in performance counter units
+    MixKernel kernel;
+    MixerSound sounds[SOUND_COUNT];
+    MixerVoice voices[MIXER_VOICES];
+    unsigned long nextSerial;
+    Uint64 lastCallback;
+    SoundId requests[MIXER_REQUESTS];
+    atomic_uint requestHead; // written by the game thread
+    atomic_uint requestTail; // written by the callback
+    // Stats, written by the callback and safe to read from any thread
+    atomic_ulong callbacks;
+    atomic_ulong underruns;  // callbacks that ran over budget or came more than two buffers late
+    atomic_ulong stolen;     // voices cut off to start a newer sound
+    atomic_ulong dropped;    // requests lost to a full ring
+    atomic_ullong busy;      // total callback time
+    atomic_ullong slowest;
+} AudioMixer;
+
+bool openAudioMixer(AudioMixer *mixer, const MixerSound sounds[SOUND_COUNT], int samples);
+bool decodeMixerSound(MixerSound *sound, const char *path);
+bool openOfflineMixer(AudioMixer *mixer, const char *paths[SOUND_COUNT]);
+void closeAudioMixer(AudioMixer *mixer);
+void mixerPlay(AudioMixer *mixer, SoundId sound);
+void reportAudioMixer(AudioMixer *mixer);
+MixKernel mixerBestKernel(void);
+int16_t *renderAudioOffline(AudioMixer *mixer, const TimedSound *timeline, int count, int frames);
+bool writeWav(SDL_RWops *out, const int16_t *pcm, int frames);
+
+#endif // AUDIO_MIXER_H
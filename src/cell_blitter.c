@@ -0,0 +1,210 @@
+#include "cell_blitter.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CELL_BLITTER_X86 1
+#include <immintrin.h>
+#endif
+
+// Source-over blend of one channel, rounded exactly like x / 255.0 + 0.5.
+// The destination alpha is blended with a source value of 255, so
+// out = src * a + dst * (1 - a) for colour and a + dstA * (1 - a) for alpha.
+static inline uint32_t blendChannel(uint32_t src, uint32_t dst, uint32_t alpha) {
+    uint32_t t = src * alpha + dst * (255 - alpha) + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static void blendRowScalar(uint32_t *dst, const uint32_t *src, int count) {
+    for (int i = 0; i < count; i++) {
+        uint32_t s = src[i] | 0xFF000000u;
+        uint32_t d = dst[i];
+        uint32_t alpha = src[i] >> 24;
+        uint32_t out = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            out |= blendChannel((s >> shift) & 0xFF, (d >> shift) & 0xFF, alpha) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+#ifdef CELL_BLITTER_X86
+// Two pixels per register as 16-bit channels; every intermediate fits in
+// an unsigned 16-bit lane, so the result matches blendChannel() exactly.
+__attribute__((target("sse4.1")))
+static inline __m128i blendPixelsSse(__m128i src, __m128i dst, __m128i alpha) {
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+    __m128i t = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, _mm_sub_epi16(full, alpha))), half);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("sse4.1")))
+static void blendRowSse(uint32_t *dst, const uint32_t *src, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000u);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i sLo = _mm_unpacklo_epi8(s, zero);
+        __m128i sHi = _mm_unpackhi_epi8(s, zero);
+        // ARGB8888 in memory is B, G, R, A: alpha is the fourth channel of each pixel
+        __m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo, 0xFF), 0xFF);
+        __m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi, 0xFF), 0xFF);
+        s = _mm_or_si128(s, opaque);
+        __m128i lo = blendPixelsSse(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), aLo);
+        __m128i hi = blendPixelsSse(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), aHi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    blendRowScalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blendPixelsAvx2(__m256i src, __m256i dst, __m256i alpha) {
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i half = _mm256_set1_epi16(128);
+    __m256i t = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(src, alpha), _mm256_mullo_epi16(dst, _mm256_sub_epi16(full, alpha))), half);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static void blendRowAvx2(uint32_t *dst, const uint32_t *src, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i opaque = _mm256_set1_epi32((int)0xFF000000u);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        // Unpacks and packs stay within 128-bit lanes, so pixel order survives the round trip
+        __m256i sLo = _mm256_unpacklo_epi8(s, zero);
+        __m256i sHi = _mm256_unpackhi_epi8(s, zero);
+        __m256i aLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sLo, 0xFF), 0xFF);
+        __m256i aHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sHi, 0xFF), 0xFF);
+        s = _mm256_or_si256(s, opaque);
+        __m256i lo = blendPixelsAvx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), aLo);
+        __m256i hi = blendPixelsAvx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), aHi);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    blendRowSse(dst + i, src + i, count - i);
+}
+#endif
+
+BlitKernel cellBlitterBestKernel(void) {
+#ifdef CELL_BLITTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return BLIT_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return BLIT_KERNEL_SSE;
+    }
+#endif
+    return BLIT_KERNEL_SCALAR;
+}
+
+// Writes source as seen in the given orientation: each destination pixel
+// takes the texel found by undoing the clockwise turns, then the flip.
+void rotateCellTile(uint32_t *tile, const uint32_t *source, int size, int orientation) {
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int u = x;
+            int v = y;
+            for (int t = 0; t < orientation % 4; t++) {
+                int rotated = v;
+                v = size - 1 - u;
+                u = rotated;
+            }
+            if (orientation >= 4) v = size - 1 - v;
+            tile[y * size + x] = source[v * size + u];
+        }
+    }
+}
+
+// Draws every blit clipped to rows [top, bottom). Blits are applied in
+// order, so each band ends up exactly as a single pass would leave it.
+static void drawBand(CellBlitter *blitter, int top, int bottom) {
+    void (*blendRow)(uint32_t *, const uint32_t *, int) = blendRowScalar;
+#ifdef CELL_BLITTER_X86
+    if (blitter->kernel == BLIT_KERNEL_AVX2) blendRow = blendRowAvx2;
+    if (blitter->kernel == BLIT_KERNEL_SSE) blendRow = blendRowSse;
+#endif
+    int size = blitter->tileSize;
+    for (int i = 0; i < blitter->count; i++) {
+        const CellBlit *blit = &blitter->blits[i];
+        int x0 = blit->x < 0 ? 0 : blit->x;
+        int x1 = blit->x + size > blitter->width ? blitter->width : blit->x + size;
+        int y0 = blit->y < top ? top : blit->y;
+        int y1 = blit->y + size > bottom ? bottom : blit->y + size;
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        const uint32_t *tile = blitter->tiles + (size_t)(blit->sprite * CELL_ORIENTATIONS + blit->orientation) * size * size;
+        for (int y = y0; y < y1; y++) {
+            blendRow(blitter->pixels + (size_t)y * blitter->pitch + x0,
+                     tile + (size_t)(y - blit->y) * size + (x0 - blit->x), x1 - x0);
+        }
+    }
+}
+
+static void bandRows(const CellBlitter *blitter, int band, int *top, int *bottom) {
+    *top = blitter->height * band / blitter->bands;
+    *bottom = blitter->height * (band + 1) / blitter->bands;
+}
+
+// Worker job of the group: one row band per worker.
+static void drawBandJob(void *context, int band) {
+    CellBlitter *blitter = context;
+    int top, bottom;
+    bandRows(blitter, band, &top, &bottom);
+    drawBand(blitter, top, bottom);
+}
+
+// sprites holds spriteCount unrotated tileSize x tileSize ARGB8888 images
+// back to back. threads <= 1 draws on the calling thread only.
+bool cellBlitterInit(CellBlitter *blitter, const uint32_t *sprites, int spriteCount, int tileSize, int threads) {
+    memset(blitter, 0, sizeof(*blitter));
+    size_t area = (size_t)tileSize * tileSize;
+    blitter->tileSize = tileSize;
+    blitter->spriteCount = spriteCount;
+    blitter->kernel = cellBlitterBestKernel();
+    blitter->bands = threads > 1 ? threads : 1;
+    blitter->tiles = malloc(sizeof(uint32_t) * area * spriteCount * CELL_ORIENTATIONS);
+    if (!blitter->tiles) {
+        return false;
+    }
+
+    for (int sprite = 0; sprite < spriteCount; sprite++) {
+        for (int orientation = 0; orientation < CELL_ORIENTATIONS; orientation++) {
+            rotateCellTile(blitter->tiles + area * (sprite * CELL_ORIENTATIONS + orientation),
+                           sprites + area * sprite, tileSize, orientation);
+        }
+    }
+
+    if (!workerGroupInit(&blitter->group, blitter->bands, drawBandJob, blitter)) {
+        free(blitter->tiles);
+        memset(blitter, 0, sizeof(*blitter));
+        return false;
+    }
+    return true;
+}
+
+void cellBlitterFree(CellBlitter *blitter) {
+    if (!blitter->tiles) {
+        return;
+    }
+    workerGroupFree(&blitter->group);
+    free(blitter->tiles);
+    memset(blitter, 0, sizeof(*blitter));
+}
+
+// Blends every blit into the framebuffer in order; pitch is in pixels.
+void cellBlitterDraw(CellBlitter *blitter, uint32_t *pixels, int width, int height, int pitch, const CellBlit *blits, int count) {
+    blitter->pixels = pixels;
+    blitter->width = width;
+    blitter->height = height;
+    blitter->pitch = pitch;
+    blitter->blits = blits;
+    blitter->count = count;
+    workerGroupRun(&blitter->group);
+}
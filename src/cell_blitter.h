@@ -0,0 +1,52 @@
+#ifndef CELL_BLITTER_H
+#define CELL_BLITTER_H
+
+// CPU blitter for the fixed set of square cell sprites. Every sprite is
+// stored pre-rotated in all eight orientations, so a draw is an unscaled,
+// unrotated alpha blend of one tile into an ARGB8888 framebuffer. Work is
+// split across threads by row bands; every kernel and thread count produces
+// the same pixels as the scalar reference.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "worker_group.h"
+
+// Four clockwise quarter turns, each optionally flipped vertically afterwards
+#define CELL_ORIENTATIONS 8
+#define CELL_ORIENTATION(turns, flipped) ((turns) + ((flipped) ? 4 : 0))
+
+typedef enum {
+    BLIT_KERNEL_SCALAR,
+    BLIT_KERNEL_SSE,
+    BLIT_KERNEL_AVX2
+} BlitKernel;
+
+typedef struct {
+    int sprite;
+    int orientation;
+    int x;               // top-left corner in pixels, may lie partly off-screen
+    int y;
+} CellBlit;
+
+typedef struct {
+    int tileSize;
+    int spriteCount;
+    uint32_t *tiles;     // spriteCount * CELL_ORIENTATIONS tiles of tileSize^2 pixels
+    BlitKernel kernel;
+    int bands;           // the caller draws band 0, one worker thread per other band
+    WorkerGroup group;
+    uint32_t *pixels;    // job being drawn
+    int width;
+    int height;
+    int pitch;           // in pixels
+    const CellBlit *blits;
+    int count;
+} CellBlitter;
+
+bool cellBlitterInit(CellBlitter *blitter, const uint32_t *sprites, int spriteCount, int tileSize, int threads);
+void cellBlitterFree(CellBlitter *blitter);
+void cellBlitterDraw(CellBlitter *blitter, uint32_t *pixels, int width, int height, int pitch, const CellBlit *blits, int count);
+BlitKernel cellBlitterBestKernel(void);
+void rotateCellTile(uint32_t *tile, const uint32_t *source, int size, int orientation);
+
+#endif // CELL_BLITTER_H
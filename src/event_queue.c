@@ -0,0 +1,75 @@
+#include "event_queue.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// capacity is rounded up to a power of two.
+bool eventQueueInit(EventQueue *queue, size_t capacity) {
+    memset(queue, 0, sizeof(*queue));
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    queue->slots = malloc(sizeof(EventSlot) * size);
+    if (!queue->slots) {
+        return false;
+    }
+    queue->mask = size - 1;
+    // Slot i is free for the producer claiming position i
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&queue->slots[i].sequence, i);
+    }
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->published, 0);
+    atomic_init(&queue->dropped, 0);
+    return true;
+}
+
+void eventQueueFree(EventQueue *queue) {
+    free(queue->slots);
+    memset(queue, 0, sizeof(*queue));
+}
+
+// Never blocks. Returns false and counts a drop when the consumer is a full
+// ring behind.
+bool publishEvent(EventQueue *queue, const GameEvent *event) {
+    size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    EventSlot *slot;
+    for (;;) {
+        slot = &queue->slots[position & queue->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t lag = (intptr_t)(sequence - position);
+        if (lag == 0) {
+            // Free slot, claim it unless another producer got there first
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+            return false;
+        } else {
+            position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+    slot->event = *event;
+    // Hands the slot to the consumer
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    atomic_fetch_add_explicit(&queue->published, 1, memory_order_relaxed);
+    return true;
+}
+
+// Single consumer only. Returns false when no event is ready.
+bool consumeEvent(EventQueue *queue, GameEvent *event) {
+    if (!queue->slots) {
+        return false;
+    }
+    EventSlot *slot = &queue->slots[queue->tail & queue->mask];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != queue->tail + 1) {
+        return false;
+    }
+    *event = slot->event;
+    // Frees the slot for the producer one lap ahead
+    atomic_store_explicit(&slot->sequence, queue->tail + queue->mask + 1, memory_order_release);
+    queue->tail++;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+// Bounded lock-free queue of gameplay events. Any number of threads may
+// publish, one thread consumes. Each slot carries a sequence number telling
+// producers and the consumer whose turn it is, so neither side ever takes
+// a lock or waits on the other; a full queue drops the event and counts it.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "snake_core.h"
+
+typedef enum {
+    GAME_EVENT_ATE,
+    GAME_EVENT_DIED,
+    GAME_EVENT_TURNED,
+    GAME_EVENT_WON,
+    GAME_EVENT_TYPES
+} GameEventType;
+
+typedef struct {
+    GameEventType type;
+    Point cell;          // head cell after the tick
+    int score;
+    Direction direction; // new direction of GAME_EVENT_TURNED
+} GameEvent;
+
+typedef struct {
+    atomic_size_t sequence;
+    GameEvent event;
+} EventSlot;
+
+typedef struct {
+    EventSlot *slots;
+    size_t mask;                 // capacity - 1, capacity is a power of two
+    atomic_size_t head;          // next slot to publish into, shared by producers
+    size_t tail;                 // next slot to consume, consumer only
+    atomic_ulong published;
+    atomic_ulong dropped;
+} EventQueue;
+
+bool eventQueueInit(EventQueue *queue, size_t capacity);
+void eventQueueFree(EventQueue *queue);
+bool publishEvent(EventQueue *queue, const GameEvent *event);
+bool consumeEvent(EventQueue *queue, GameEvent *event);
+
+#endif // EVENT_QUEUE_H
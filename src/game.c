@@ -1,62 +1,50 @@
 #include "game.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h> 
-#include <pthread.h>
 
-SDL_Texture *loadTexture(SnakeGame *game, const char *path) {
-    SDL_Surface *surface = IMG_Load(path);
-    if (!surface) {
-        printf("Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError());
-        return NULL;
-    }
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(game->renderer, surface);
-    SDL_FreeSurface(surface);
-    return texture;
-}
+static const char *soundPaths[SOUND_COUNT] = {
+    [SOUND_APPLE_EAT] = "assets/default_textures/sounds/apple_eat.wav",
+};
 
-void generateFood(SnakeGame *game) {
-    game->food.x = rand() % (SCREEN_WIDTH / CELL_SIZE) * CELL_SIZE;
-    game->food.y = rand() % (SCREEN_HEIGHT / CELL_SIZE) * CELL_SIZE;
-    for (int i = 0; i < game->snakeLength; i++) {
-        if (game->snake[i].x == game->food.x && game->snake[i].y == game->food.y) {
-            generateFood(game);
-        }
+// Queues a turn, validated against the direction that will be in effect
+// once every turn already queued has been applied.
+static void queueTurn(SnakeGame *game, Direction direction, Uint32 timestamp) {
+    InputQueue *queue = &game->input;
+    Direction effective = game->sim.direction;
+    if (queue->count > 0) {
+        effective = queue->intents[(queue->head + queue->count - 1) % INPUT_QUEUE_SIZE].direction;
     }
-}
-
-void *playSoundEffect(void *arg) {
-    const char *path = (const char *)arg;
-    Mix_Chunk *sound = Mix_LoadWAV(path);
-    if (!sound) {
-        printf("Failed to load sound! SDL_mixer Error: %s\n", Mix_GetError());
-        return NULL;
-    }
-    Mix_PlayChannel(-1, sound, 0);
-    while (Mix_Playing(-1) != 0) {
-        SDL_Delay(100);
+    if (direction == effective || (direction + 2) % 4 == effective || queue->count == INPUT_QUEUE_SIZE) {
+        return;
     }
-    Mix_FreeChunk(sound);
-    return NULL;
+    queue->intents[(queue->head + queue->count) % INPUT_QUEUE_SIZE] = (InputIntent){direction, timestamp};
+    queue->count++;
 }
 
-void playSound(const char *path) {
-    pthread_t soundThread;
-    pthread_create(&soundThread, NULL, playSoundEffect, (void *)path);
-    pthread_detach(soundThread);
+// update() only reports what happened, every consumer gets its own queue
+// and drains it on its own schedule.
+static void emitEvent(SnakeGame *game, GameEventType type) {
+    GameEvent event = {type, snakeSegment(&game->sim, 0), game->sim.score, game->sim.direction};
+    publishEvent(&game->audioEvents, &event);
+    publishEvent(&game->statsEvents, &event);
 }
 
-bool checkCollision(SnakeGame *game) {
-    if (game->snake[0].x < 0 || game->snake[0].x >= SCREEN_WIDTH ||
-        game->snake[0].y < 0 || game->snake[0].y >= SCREEN_HEIGHT) {
-        return true;
+// Applies at most one queued turn per tick.
+static void applyQueuedTurn(SnakeGame *game) {
+    InputQueue *queue = &game->input;
+    if (queue->count == 0) {
+        return;
     }
-    for (int i = 1; i < game->snakeLength; ++i) {
-        if (game->snake[0].x == game->snake[i].x && game->snake[0].y == game->snake[i].y) {
-            return true;
-        }
+    InputIntent intent = queue->intents[queue->head];
+    queue->head = (queue->head + 1) % INPUT_QUEUE_SIZE;
+    queue->count--;
+    if (snakeTurn(&game->sim, intent.direction)) {
+        emitEvent(game, GAME_EVENT_TURNED);
+        game->stats.inputs++;
+        game->stats.inputLatencyTotal += SDL_GetTicks() - intent.timestamp;
     }
-    return false;
 }
 
 void handleInput(SnakeGame *game) {
@@ -64,222 +52,495 @@ void handleInput(SnakeGame *game) {
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             game->running = false;
+        } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+            game->boardStale = true;
         } else if (event.type == SDL_KEYDOWN) {
             switch (event.key.keysym.sym) {
                 case SDLK_UP:
-                    if (game->direction != DOWN) game->direction = UP;
+                    queueTurn(game, UP, event.key.timestamp);
                     break;
                 case SDLK_DOWN:
-                    if (game->direction != UP) game->direction = DOWN;
+                    queueTurn(game, DOWN, event.key.timestamp);
                     break;
                 case SDLK_LEFT:
-                    if (game->direction != RIGHT) game->direction = LEFT;
+                    queueTurn(game, LEFT, event.key.timestamp);
                     break;
                 case SDLK_RIGHT:
-                    if (game->direction != LEFT) game->direction = RIGHT;
+                    queueTurn(game, RIGHT, event.key.timestamp);
+                    break;
+                case SDLK_EQUALS:
+                case SDLK_PLUS:
+                case SDLK_KP_PLUS:
+                    if (game->scale * 2 <= MAX_CELL_SIZE) game->zoom *= 2;
+                    break;
+                case SDLK_MINUS:
+                case SDLK_KP_MINUS:
+                    if (game->zoom > 1) game->zoom /= 2;
                     break;
             }
         }
     }
 }
 
+void renderText(SnakeGame *game, const char *text, int x, int y) {
+    SDL_Color color = {255, 255, 255, 255};
+    drawText(&game->textAtlas, game->renderer, text, x, y, color);
+}
+
+// Draws a segment from the orientation code the simulation keeps for it
+static void queueSegment(SnakeGame *game, uint8_t code, const SDL_FRect *rect)
+{
+    static const SpriteId sprites[4] = {
+        [SEGMENT_HEAD] = SPRITE_HEAD,
+        [SEGMENT_BODY] = SPRITE_BODY,
+        [SEGMENT_TURN] = SPRITE_TURN,
+        [SEGMENT_TAIL] = SPRITE_TAIL,
+    };
+    queueSprite(&game->sprites, game->renderer, sprites[SEGMENT_KIND(code)], rect,
+                SEGMENT_TURNS(code) * 90.0, SEGMENT_FLIPPED(code) ? SDL_FLIP_VERTICAL : SDL_FLIP_NONE);
+}
+
+// Offset from one cell to its neighbour along one axis, -1, 0 or 1 across the wrap-around edge.
+static int cellStep(int from, int to, int size)
+{
+    int delta = to - from;
+    if (delta > 1) delta -= size;
+    else if (delta < -1) delta += size;
+    return delta;
+}
+
+// Where a cell, or a point between cells, lands in the current viewport
+static SDL_FRect cellFRect(SnakeGame *game, float x, float y)
+{
+    return (SDL_FRect){x * game->scale - game->origin.x, y * game->scale - game->origin.y, game->scale, game->scale};
+}
+
+// Draws a sprite part of the way from one cell to the next. When the move
+// crosses a board edge the sprite is drawn on both sides so it slides out
+// of one edge while sliding in at the other.
+static void renderInterpolated(SnakeGame *game, uint8_t code, Point from, Point to, float alpha)
+{
+    int dx = cellStep(from.x, to.x, game->sim.width);
+    int dy = cellStep(from.y, to.y, game->sim.height);
+    SDL_FRect rect = cellFRect(game, from.x + dx * alpha, from.y + dy * alpha);
+    queueSegment(game, code, &rect);
+    if (from.x + dx != to.x || from.y + dy != to.y)
+    {
+        rect = cellFRect(game, to.x - dx * (1.0f - alpha), to.y - dy * (1.0f - alpha));
+        queueSegment(game, code, &rect);
+    }
+}
+
+static SDL_Rect cellRect(SnakeGame *game, Point cell)
+{
+    return (SDL_Rect){cell.x * game->cellSize, cell.y * game->cellSize, game->cellSize, game->cellSize};
+}
+
+// Puts the background back under one cell of the current render target
+static void restoreBackground(SnakeGame *game, Point cell)
+{
+    SDL_Rect dest = cellRect(game, cell);
+    int width, height;
+    SDL_QueryTexture(game->backgroundTexture, NULL, NULL, &width, &height);
+    // Until the resampled background arrives the old one is still scaled to fit
+    SDL_Rect source = {dest.x * width / game->boardRect.w, dest.y * height / game->boardRect.h,
+                       dest.w * width / game->boardRect.w, dest.h * height / game->boardRect.h};
+    SDL_RenderFillRect(game->renderer, &dest);
+    SDL_RenderCopy(game->renderer, game->backgroundTexture, &source, &dest);
+}
+
+static void queueFood(SnakeGame *game)
+{
+    SDL_FRect rect = cellFRect(game, game->sim.food.x, game->sim.food.y);
+    queueSprite(&game->sprites, game->renderer, SPRITE_APPLE, &rect, 0.0, SDL_FLIP_NONE);
+}
+
+// Draws everything that only changes on ticks: the background, the food and
+// every segment between the neck and the tail. The head and the tail slide
+// every frame and are drawn on top in render().
+static void drawBoard(SnakeGame *game)
+{
+    SDL_RenderFillRect(game->renderer, NULL);
+    SDL_RenderCopy(game->renderer, game->backgroundTexture, NULL, NULL);
+    SnakeIterator it = snakeBegin(&game->sim);
+    Point segment;
+    uint8_t code;
+    int last = game->sim.length - 1;
+    for (int i = 0; snakeNextCoded(&game->sim, &it, &segment, &code); ++i)
+    {
+        if (i > 0 && i < last)
+        {
+            SDL_FRect rect = cellFRect(game, segment.x, segment.y);
+            queueSegment(game, code, &rect);
+        }
+    }
+    queueFood(game);
+    flushSprites(&game->sprites, game->renderer);
+}
+
+static void rebuildBoard(SnakeGame *game)
+{
+    SDL_SetRenderTarget(game->renderer, game->boardTexture);
+    drawBoard(game);
+    SDL_SetRenderTarget(game->renderer, NULL);
+    game->boardStale = false;
+}
+
+// After a tick only a handful of board cells change: the old head became the
+// neck, the cell that became the tail is now drawn per frame, and eating
+// moves the food from under the head to a new cell.
+static void patchBoard(SnakeGame *game, int result)
+{
+    if (!game->boardTexture || game->boardStale)
+    {
+        return;
+    }
+    if (!(result & SNAKE_STEP_MOVED) || (result & SNAKE_STEP_DIED))
+    {
+        game->boardStale = true;
+        return;
+    }
+    SDL_SetRenderTarget(game->renderer, game->boardTexture);
+    Point head = snakeSegment(&game->sim, 0);
+    Point neck = snakeSegment(&game->sim, 1);
+    restoreBackground(game, neck);
+    if (result & SNAKE_STEP_ATE)
+    {
+        restoreBackground(game, head);
+        queueFood(game);
+    }
+    else
+    {
+        restoreBackground(game, snakeSegment(&game->sim, game->sim.length - 1));
+    }
+    if (game->sim.length > 2)
+    {
+        SDL_FRect rect = cellFRect(game, neck.x, neck.y);
+        queueSegment(game, snakeSegmentCode(&game->sim, 1), &rect);
+    }
+    flushSprites(&game->sprites, game->renderer);
+    SDL_SetRenderTarget(game->renderer, NULL);
+}
+
 void update(SnakeGame *game) {
-    Point newHead = game->snake[0];
-    switch (game->direction) {
-        case UP:
-            newHead.y -= CELL_SIZE;
-            break;
-        case DOWN:
-            newHead.y += CELL_SIZE;
-            break;
-        case LEFT:
-            newHead.x -= CELL_SIZE;
-            break;
-        case RIGHT:
-            newHead.x += CELL_SIZE;
-            break;
-    }
-    if (newHead.x < 0) newHead.x = SCREEN_WIDTH - CELL_SIZE;
-    else if (newHead.x >= SCREEN_WIDTH) newHead.x = 0;
-    if (newHead.y < 0) newHead.y = SCREEN_HEIGHT - CELL_SIZE;
-    else if (newHead.y >= SCREEN_HEIGHT) newHead.y = 0;
-    if (newHead.x == game->food.x && newHead.y == game->food.y) {
-        game->snakeLength++;
-        generateFood(game);
-        game->score++;
-        playSound("assets/default_textures/sounds/apple_eat.wav");
-    }
-    for (int i = game->snakeLength - 1; i > 0; --i) {
-        game->snake[i] = game->snake[i - 1];
-    }
-    game->snake[0] = newHead;
-    if (checkCollision(game)) {
+    applyQueuedTurn(game);
+    // Remembered so render() can slide the tail out of the cell it leaves
+    game->previousTail = snakeSegment(&game->sim, game->sim.length - 1);
+    int result = snakeStep(&game->sim);
+    patchBoard(game, result);
+    if (result & SNAKE_STEP_ATE) {
+        emitEvent(game, GAME_EVENT_ATE);
+    }
+    if (result & SNAKE_STEP_DIED) {
+        emitEvent(game, GAME_EVENT_DIED);
+    }
+    if (result & SNAKE_STEP_WON) {
+        emitEvent(game, GAME_EVENT_WON);
+    }
+    if (result & (SNAKE_STEP_DIED | SNAKE_STEP_WON)) {
         game->gameState = GAME_OVER;
     }
 }
 
-void renderText(SnakeGame *game, const char *text, int x, int y) {
-    SDL_Color color = {255, 255, 255, 255};
-    SDL_Surface *surface = TTF_RenderText_Solid(game->font, text, color);
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(game->renderer, surface);
-    SDL_Rect destRect = {x, y, surface->w, surface->h};
-    SDL_RenderCopy(game->renderer, texture, NULL, &destRect);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
+// Headless runs with --dump-audio only note when each sound starts, the
+// audio is rendered offline once the run is over.
+static void recordSound(SnakeGame *game, SoundId sound) {
+    if (game->audioTimelineCount == game->audioTimelineCapacity) {
+        int capacity = game->audioTimelineCapacity ? game->audioTimelineCapacity * 2 : 64;
+        TimedSound *timeline = realloc(game->audioTimeline, sizeof(TimedSound) * capacity);
+        if (!timeline) {
+            return;
+        }
+        game->audioTimeline = timeline;
+        game->audioTimelineCapacity = capacity;
+    }
+    game->audioTimeline[game->audioTimelineCount++] = (TimedSound){game->audioClock, sound};
 }
 
-void render(SnakeGame *game) 
-{   
-    SDL_RenderClear(game->renderer);
-    // Render background
-    SDL_RenderCopy(game->renderer, game->backgroundTexture, NULL, NULL);
+// Consumers of the events published by update(), run once per frame.
+static void consumeGameEvents(SnakeGame *game) {
+    GameEvent event;
+    while (consumeEvent(&game->audioEvents, &event)) {
+        if (event.type == GAME_EVENT_ATE && game->options.headlessFrames > 0 && game->options.dumpAudio) {
+            recordSound(game, SOUND_APPLE_EAT);
+        } else if (event.type == GAME_EVENT_ATE && game->mixer.device) {
+            mixerPlay(&game->mixer, SOUND_APPLE_EAT);
+        } else if (event.type == GAME_EVENT_ATE) {
+            playSound(&game->sounds, SOUND_APPLE_EAT);
+        }
+    }
+    while (consumeEvent(&game->statsEvents, &event)) {
+        game->stats.events++;
+        game->stats.eventCounts[event.type]++;
+    }
+}
+
+static unsigned long droppedEvents(SnakeGame *game) {
+    return atomic_load(&game->audioEvents.dropped) + atomic_load(&game->statsEvents.dropped);
+}
 
-    // Render snake
-    SDL_Rect rect;
-    double angle = 0.0;
-    SDL_RendererFlip flip = SDL_FLIP_NONE;
+// The tail slides out of the cell it left, over a body piece filling the
+// cell it moves into, and the head slides in from the neck.
+static void queueMovingEnds(SnakeGame *game, float alpha)
+{
+    int last = game->sim.length - 1;
+    Point tail = snakeSegment(&game->sim, last);
+    Point previousTail = game->previousTail;
+    if (previousTail.x != tail.x || previousTail.y != tail.y)
+    {
+        SDL_FRect rect = cellFRect(game, tail.x, tail.y);
+        queueSegment(game, snakeBodyCode(snakeSegmentMove(&game->sim, last), snakeSegmentMove(&game->sim, last - 1)), &rect);
+    }
+    renderInterpolated(game, snakeSegmentCode(&game->sim, last), previousTail, tail, alpha);
+    renderInterpolated(game, snakeSegmentCode(&game->sim, 0), snakeSegment(&game->sim, 1), snakeSegment(&game->sim, 0), alpha);
+}
+
+static const SDL_Color lodBodyColor = {46, 160, 67, 255};
+static const SDL_Color lodHeadColor = {170, 240, 120, 255};
+static const SDL_Color lodFoodColor = {220, 40, 40, 255};
+
+// Top-left board pixel of the camera: centred on a board smaller than the
+// output, otherwise following the focus without showing past the edges.
+static float cameraOrigin(float focus, float boardSize, int outputSize)
+{
+    if (boardSize <= outputSize)
+    {
+        return (boardSize - outputSize) / 2.0f;
+    }
+    float origin = focus - outputSize / 2.0f;
+    if (origin < 0.0f) return 0.0f;
+    if (origin > boardSize - outputSize) return boardSize - outputSize;
+    return origin;
+}
 
-    for (int i = 0; i < game->snakeLength; ++i)
+static void cameraSprites(SnakeGame *game, SDL_Rect visible, float alpha)
+{
+    SnakeState *sim = &game->sim;
+    for (int y = visible.y; y < visible.y + visible.h; y++)
     {
-        rect = (SDL_Rect){game->snake[i].x, game->snake[i].y, CELL_SIZE, CELL_SIZE};
-        if (i == 0)
+        for (int x = visible.x; x < visible.x + visible.w; x++)
         {
-            // Determine the rotation angle for the head based on the direction
-            double angle;
-            switch (game->direction)
+            // Head and tail move every frame and are drawn by queueMovingEnds()
+            int segment = snakeSegmentAt(sim, (Point){x, y});
+            if (segment > 0 && segment < sim->length - 1)
             {
-            case UP:
-                angle = 270.0;
-                break;
-            case DOWN:
-                angle = 90;
-                break;
-            case RIGHT:
-                angle = 0.0;
-                break;
-            case LEFT:
-                angle = 180.0;
-                break;
-            default:
-                angle = 0.0;
-                break;
+                SDL_FRect rect = cellFRect(game, x, y);
+                queueSegment(game, snakeSegmentCode(sim, segment), &rect);
             }
-            SDL_RenderCopyEx(game->renderer, game->headTexture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
         }
-        else if (i == game->snakeLength - 1)
+    }
+    if (SDL_PointInRect(&(SDL_Point){sim->food.x, sim->food.y}, &visible))
+    {
+        queueFood(game);
+    }
+    queueMovingEnds(game, alpha);
+}
+
+static void fillCells(SnakeGame *game, const SDL_FRect *rects, int count, SDL_Color color)
+{
+    SDL_SetRenderDrawColor(game->renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRectsF(game->renderer, rects, count);
+}
+
+static void cameraRects(SnakeGame *game, SDL_Rect visible)
+{
+    SnakeState *sim = &game->sim;
+    int needed = visible.w * visible.h;
+    if (needed > game->cellRectCapacity)
+    {
+        SDL_FRect *rects = realloc(game->cellRects, sizeof(SDL_FRect) * needed);
+        if (!rects)
+        {
+            return;
+        }
+        game->cellRects = rects;
+        game->cellRectCapacity = needed;
+    }
+    int count = 0;
+    for (int y = visible.y; y < visible.y + visible.h; y++)
+    {
+        for (int x = visible.x; x < visible.x + visible.w; x++)
         {
-            // Determine the rotation angle for the tail based on the direction
-            Point prevSegment = game->snake[i - 1];
-            // Edge cases
-            if ((prevSegment.x == (SCREEN_WIDTH - CELL_SIZE)) && (game->snake[i].x == 0))
-            {
-                angle = 180.0;
-            }
-            else if ((prevSegment.x == 0) && (game->snake[i].x == (SCREEN_WIDTH - CELL_SIZE)))
-            {
-                angle = 0.0;
-            }
-            else if ((prevSegment.y == (SCREEN_HEIGHT - CELL_SIZE)) && (game->snake[i].y == 0))
-            {
-                angle = 270.0;
-            }
-            else if ((prevSegment.y == 0) && (game->snake[i].y == (SCREEN_HEIGHT - CELL_SIZE)))
-            {
-                angle = 90.0;
-            }
-            // Normal cases
-            else if ((prevSegment.x < game->snake[i].x))
-            {
-                angle = 180.0; // Tail pointing left
-            }
-            else if ((prevSegment.x > game->snake[i].x))
+            if (snakeCellOccupied(sim, y * sim->width + x))
             {
-                angle = 0.0; // Tail pointing right
+                game->cellRects[count++] = cellFRect(game, x, y);
             }
-            else if ((prevSegment.y < game->snake[i].y))
-            {
-                angle = 270.0; // Tail pointing up
-            }
-            else if ((prevSegment.y > game->snake[i].y))
-            {
-                angle = 90.0; // Tail pointing down
-            }
-            SDL_RenderCopyEx(game->renderer, game->tailTexture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
         }
-        else
+    }
+    fillCells(game, game->cellRects, count, lodBodyColor);
+    Point head = snakeSegment(sim, 0);
+    SDL_FRect rect = cellFRect(game, head.x, head.y);
+    fillCells(game, &rect, 1, lodHeadColor);
+    rect = cellFRect(game, sim->food.x, sim->food.y);
+    fillCells(game, &rect, 1, lodFoodColor);
+    SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 255);
+}
+
+static Uint32 texelColor(SDL_Color color)
+{
+    return (Uint32)color.a << 24 | (Uint32)color.r << 16 | (Uint32)color.g << 8 | color.b;
+}
+
+// One texel per block of cells, set when any cell of the block is covered,
+// so even a one-cell snake stays visible however far we zoom out.
+static void cameraTexels(SnakeGame *game, SDL_Rect visible)
+{
+    SnakeState *sim = &game->sim;
+    int block = (int)SDL_ceilf(1.0f / game->scale);
+    int width = (visible.w + block - 1) / block;
+    int height = (visible.h + block - 1) / block;
+    if (width > game->cellTextureWidth || height > game->cellTextureHeight)
+    {
+        if (game->cellTexture) SDL_DestroyTexture(game->cellTexture);
+        game->cellTexture = SDL_CreateTexture(game->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (!game->cellTexture)
+        {
+            game->cellTextureWidth = game->cellTextureHeight = 0;
+            return;
+        }
+        SDL_SetTextureBlendMode(game->cellTexture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(game->cellTexture, SDL_ScaleModeNearest);
+        game->cellTextureWidth = width;
+        game->cellTextureHeight = height;
+    }
+    SDL_Rect area = {0, 0, width, height};
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(game->cellTexture, &area, &pixels, &pitch) != 0)
+    {
+        return;
+    }
+    for (int y = 0; y < height; y++)
+    {
+        memset((Uint8 *)pixels + (size_t)y * pitch, 0, (size_t)width * 4);
+    }
+    Uint32 body = texelColor(lodBodyColor);
+    for (int y = visible.y; y < visible.y + visible.h; y++)
+    {
+        Uint32 *row = (Uint32 *)((Uint8 *)pixels + (size_t)((y - visible.y) / block) * pitch);
+        for (int x = visible.x; x < visible.x + visible.w; x++)
         {
-            // Determine if this segment is turning
-            Point prevSegment = game->snake[i - 1];
-            Point nextSegment = game->snake[i + 1];
-            if ((prevSegment.x != nextSegment.x) && (prevSegment.y != nextSegment.y))
+            int cell = y * sim->width + x;
+            // Skip whole empty occupancy words
+            if (cell % 32 == 0 && snakeOccupancyWord(sim, cell) == 0 && x + 32 <= visible.x + visible.w)
             {
-                // This segment is turning
-                if (prevSegment.y < game->snake[i].y && nextSegment.x < game->snake[i].x) // Right to Up
-                {
-                    angle = 270.0;
-                    flip = SDL_FLIP_VERTICAL;
-                }
-                else if (prevSegment.y > game->snake[i].y && nextSegment.x < game->snake[i].x) // Right to Down
-                {
-                    angle = 90.0;
-                    flip = SDL_FLIP_NONE;
-                }
-                else if (prevSegment.y < game->snake[i].y && nextSegment.x > game->snake[i].x) // Left to Up
-                {
-                    angle = 270.0;
-                    flip = SDL_FLIP_NONE;
-                }
-                else if (prevSegment.y > game->snake[i].y && nextSegment.x > game->snake[i].x) // Left to Down
-                {
-                    angle = 90.0;
-                    flip = SDL_FLIP_VERTICAL;
-                }
-                else if (prevSegment.x < game->snake[i].x && nextSegment.y < game->snake[i].y) // Bottom to Left
-                {
-                    angle = 180.0;
-                    flip = SDL_FLIP_NONE;
-                }
-                else if (prevSegment.x < game->snake[i].x && nextSegment.y > game->snake[i].y) // Bottom to Right
-                {
-                    angle = 180.0;
-                    flip = SDL_FLIP_VERTICAL;
-                }
-                else if (prevSegment.x > game->snake[i].x && nextSegment.y < game->snake[i].y) // Up to Left
-                {
-                    angle = 0.0;
-                    flip = SDL_FLIP_VERTICAL;
-                }
-                else if (prevSegment.x > game->snake[i].x && nextSegment.y > game->snake[i].y) // Up to right
-                {
-                    angle = 0.0;
-                    flip = SDL_FLIP_NONE;
-                }
-                SDL_RenderCopyEx(game->renderer, game->turnTexture, NULL, &rect, angle, NULL, flip);
+                x += 31;
+                continue;
             }
-            else
+            if (snakeCellOccupied(sim, cell))
             {
-                // Determine the rotation angle for the body segment
-                if (prevSegment.x != game->snake[i].x)
-                {
-                    angle = 0.0; // Body horizontal
-                }
-                else if (prevSegment.y != game->snake[i].y)
-                {
-                    angle = 90.0; // Body vertical
-                }
-                SDL_RenderCopyEx(game->renderer, game->bodyTexture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
+                row[(x - visible.x) / block] = body;
             }
         }
     }
+    Point marks[2] = {sim->food, snakeSegment(sim, 0)};
+    Uint32 colors[2] = {texelColor(lodFoodColor), texelColor(lodHeadColor)};
+    for (int i = 0; i < 2; i++)
+    {
+        if (SDL_PointInRect(&(SDL_Point){marks[i].x, marks[i].y}, &visible))
+        {
+            Uint32 *row = (Uint32 *)((Uint8 *)pixels + (size_t)((marks[i].y - visible.y) / block) * pitch);
+            row[(marks[i].x - visible.x) / block] = colors[i];
+        }
+    }
+    SDL_UnlockTexture(game->cellTexture);
+    SDL_FRect dest = cellFRect(game, visible.x, visible.y);
+    dest.w = width * block * game->scale;
+    dest.h = height * block * game->scale;
+    SDL_RenderCopyF(game->renderer, game->cellTexture, &area, &dest);
+}
 
-    // Render food
-    rect = (SDL_Rect){game->food.x, game->food.y, CELL_SIZE, CELL_SIZE};
-    SDL_RenderCopy(game->renderer, game->appleTexture, NULL, &rect);
+// Only cells inside the output are touched, so the cost follows the visible
+// area instead of the snake's length. The detail level follows the zoom:
+// sprites, then flat rects, then one streamed texel per block of cells.
+static void renderCamera(SnakeGame *game, float alpha)
+{
+    SnakeState *sim = &game->sim;
+    float scale = game->scale;
+    float boardWidth = sim->width * scale;
+    float boardHeight = sim->height * scale;
+    Point head = snakeSegment(sim, 0);
+    Point neck = snakeSegment(sim, 1);
+    float focusX = neck.x + cellStep(neck.x, head.x, sim->width) * alpha + 0.5f;
+    float focusY = neck.y + cellStep(neck.y, head.y, sim->height) * alpha + 0.5f;
+    game->origin.x = cameraOrigin(focusX * scale, boardWidth, game->outputWidth);
+    game->origin.y = cameraOrigin(focusY * scale, boardHeight, game->outputHeight);
+
+    int left = (int)SDL_floorf(game->origin.x / scale);
+    int top = (int)SDL_floorf(game->origin.y / scale);
+    int right = (int)SDL_ceilf((game->origin.x + game->outputWidth) / scale);
+    int bottom = (int)SDL_ceilf((game->origin.y + game->outputHeight) / scale);
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+    if (right > sim->width) right = sim->width;
+    if (bottom > sim->height) bottom = sim->height;
+    SDL_Rect visible = {left, top, right - left, bottom - top};
+
+    // Only the visible part of the background, mapped onto the whole board
+    int textureWidth, textureHeight;
+    SDL_QueryTexture(game->backgroundTexture, NULL, NULL, &textureWidth, &textureHeight);
+    float x0 = game->origin.x > 0 ? game->origin.x : 0;
+    float y0 = game->origin.y > 0 ? game->origin.y : 0;
+    float x1 = SDL_min(game->origin.x + game->outputWidth, boardWidth);
+    float y1 = SDL_min(game->origin.y + game->outputHeight, boardHeight);
+    SDL_Rect source = {(int)(x0 * textureWidth / boardWidth), (int)(y0 * textureHeight / boardHeight),
+                       (int)SDL_ceilf((x1 - x0) * textureWidth / boardWidth), (int)SDL_ceilf((y1 - y0) * textureHeight / boardHeight)};
+    SDL_FRect dest = {source.x * boardWidth / textureWidth - game->origin.x, source.y * boardHeight / textureHeight - game->origin.y,
+                      source.w * boardWidth / textureWidth, source.h * boardHeight / textureHeight};
+    SDL_RenderCopyF(game->renderer, game->backgroundTexture, &source, &dest);
+
+    if (scale >= LOD_SPRITE_CELL)
+    {
+        cameraSprites(game, visible, alpha);
+    }
+    else if (scale >= LOD_RECT_CELL)
+    {
+        cameraRects(game, visible);
+    }
+    else
+    {
+        cameraTexels(game, visible);
+    }
+}
+
+void render(SnakeGame *game) 
+{   
+    if (game->boardTexture && game->boardStale)
+    {
+        rebuildBoard(game);
+    }
+    // Everything on the board is drawn in board pixels, 1:1 with the output
+    SDL_RenderClear(game->renderer);
+    SDL_RenderSetViewport(game->renderer, &game->boardRect);
+
+    // How far we are between the last tick and the next one
+    float alpha = game->tickLength ? (float)game->tickAccumulator / game->tickLength : 1.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+
+    if (game->camera)
+    {
+        renderCamera(game, alpha);
+    }
+    else
+    {
+        // Static part of the board, kept up to date by patchBoard() on every tick
+        if (game->boardTexture)
+        {
+            SDL_RenderCopy(game->renderer, game->boardTexture, NULL, NULL);
+        }
+        else
+        {
+            drawBoard(game);
+        }
+        queueMovingEnds(game, alpha);
+    }
+    flushSprites(&game->sprites, game->renderer);
+    SDL_RenderSetViewport(game->renderer, NULL);
 
     // Render score
     char scoreText[50];
-    sprintf(scoreText, "Score: %d", game->score);
-    renderText(game, scoreText, 10, 10);
+    sprintf(scoreText, "Score: %d", game->sim.score);
+    renderText(game, scoreText, game->boardRect.x + 10, game->boardRect.y + 10);
 
     SDL_RenderPresent(game->renderer);
 }
@@ -288,16 +549,16 @@ void render(SnakeGame *game)
 
 void renderStartScreen(SnakeGame *game) {
     SDL_RenderClear(game->renderer);
-    renderText(game, "Press Enter to Start", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2);
+    renderText(game, "Press Enter to Start", game->outputWidth / 2 - 100, game->outputHeight / 2);
     SDL_RenderPresent(game->renderer);
 }
 
 void renderGameOverScreen(SnakeGame *game) {
     SDL_RenderClear(game->renderer);
     char gameOverText[50];
-    sprintf(gameOverText, "Game Over! Score: %d", game->score);
-    renderText(game, gameOverText, SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 50);
-    renderText(game, "Press Enter to Restart", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2);
+    sprintf(gameOverText, "%s Score: %d", game->sim.status == SNAKE_WON ? "You Win!" : "Game Over!", game->sim.score);
+    renderText(game, gameOverText, game->outputWidth / 2 - 100, game->outputHeight / 2 - 50);
+    renderText(game, "Press Enter to Restart", game->outputWidth / 2 - 100, game->outputHeight / 2);
     SDL_RenderPresent(game->renderer);
 }
 
@@ -306,6 +567,11 @@ void handleStartScreenInput(SnakeGame *game) {
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             game->running = false;
+        } else if (event.type == SDL_WINDOWEVENT) {
+            game->screenDirty = true;
+        } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+            game->screenDirty = true;
+            game->boardStale = true;
         } else if (event.type == SDL_KEYDOWN) {
             if (event.key.keysym.sym == SDLK_RETURN) {
                 game->gameState = GAME_RUNNING;
@@ -319,56 +585,571 @@ void handleGameOverScreenInput(SnakeGame *game) {
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             game->running = false;
+        } else if (event.type == SDL_WINDOWEVENT) {
+            game->screenDirty = true;
+        } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+            game->screenDirty = true;
+            game->boardStale = true;
         } else if (event.type == SDL_KEYDOWN) {
             if (event.key.keysym.sym == SDLK_RETURN) {
                 game->gameState = START_SCREEN;
-                game->score = 0;
-                game->snakeLength = INITIAL_LENGTH;
-                game->direction = RIGHT;
-                for (int i = 0; i < INITIAL_LENGTH; i++) {
-                    game->snake[i] = (Point){(INITIAL_LENGTH - i - 1) * CELL_SIZE, 0};
-                }
+                snakeReset(&game->sim, (uint64_t)time(NULL));
+                game->previousTail = snakeSegment(&game->sim, game->sim.length - 1);
+                game->input.count = 0;
+                game->boardStale = true;
             }
         }
     }
 }
 
+bool parseGameOptions(GameOptions *options, int argc, char* argv[]) {
+    options->vsync = true;
+    options->tickRate = 1000 / BASE_DELAY_MS;
+    options->boardWidth = GRID_WIDTH;
+    options->boardHeight = GRID_HEIGHT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-vsync") == 0) {
+            options->vsync = false;
+        } else if (strcmp(argv[i], "--blended-text") == 0) {
+            options->blendedText = true;
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options->tickRate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%dx%d", &options->boardWidth, &options->boardHeight);
+        } else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options->audioSamples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options->headlessFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc) {
+            options->dumpPrefix = argv[++i];
+        } else if (strcmp(argv[i], "--dump-audio") == 0 && i + 1 < argc) {
+            options->dumpAudio = argv[++i];
+        } else if (strcmp(argv[i], "--cpu-blit") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options->cpuBlitThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench-text") == 0) {
+            options->benchText = true;
+        } else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options->spectateBoards = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [--no-vsync] [--blended-text] [--tick-rate HZ] [--board WxH] [--audio-buffer SAMPLES] [--spectate BOARDS] [--headless FRAMES [--dump-frames PREFIX] [--dump-audio WAV] [--cpu-blit THREADS] [--bench-text]]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void requestRescale(SnakeGame *game) {
+    if (!game->scaler.running) {
+        // The camera maps the original background onto the board, only the whole-board view needs it resampled
+        int width = game->camera ? 0 : game->sim.width;
+        int height = game->camera ? 0 : game->sim.height;
+        startAssetScaler(&game->scaler, game->backgroundSource, &game->sprites, width, height, game->cellSize);
+    }
+}
+
+// Swaps in the background and sprites resampled off-thread. Uploading has
+// to happen here, on the thread that owns the renderer.
+static void collectRescale(SnakeGame *game, bool wait) {
+    AssetScaler *scaler = &game->scaler;
+    if (!scaler->running || (!wait && !assetScalerFinished(scaler))) {
+        return;
+    }
+    finishAssetScaler(scaler);
+    if (scaler->background) {
+        SDL_Texture *texture = SDL_CreateTextureFromSurface(game->renderer, scaler->background);
+        if (texture) {
+            SDL_DestroyTexture(game->backgroundTexture);
+            game->backgroundTexture = texture;
+        }
+        SDL_FreeSurface(scaler->background);
+        scaler->background = NULL;
+    }
+    if (scaler->spriteSheet) {
+        useSpriteSheet(&game->sprites, game->renderer, scaler->spriteSheet, scaler->cellSize);
+        scaler->spriteSheet = NULL;
+    }
+    if (game->options.headlessFrames > 0) {
+        printf("Assets resampled for %d px cells in %.2f ms\n", scaler->cellSize,
+               scaler->elapsed * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+    game->boardStale = true;
+    game->screenDirty = true;
+    // The window kept changing while we worked
+    if (scaler->cellSize != game->cellSize) {
+        requestRescale(game);
+    }
+}
+
+// The whole-board view never needs the camera's scratch, drop it until the camera comes back.
+static void releaseCameraScratch(SnakeGame *game) {
+    if (game->cellTexture) SDL_DestroyTexture(game->cellTexture);
+    free(game->cellRects);
+    game->cellTexture = NULL;
+    game->cellRects = NULL;
+    game->cellTextureWidth = 0;
+    game->cellTextureHeight = 0;
+    game->cellRectCapacity = 0;
+}
+
+// Fits the board into the renderer output at a whole number of pixels per
+// cell, centred, so every cached texture is drawn without scaling. Boards
+// too large for sprites, and zoomed views, switch to the camera instead.
+static void updateLayout(SnakeGame *game) {
+    int width, height;
+    SDL_GetRendererOutputSize(game->renderer, &width, &height);
+    if (width <= 0 || height <= 0 ||
+        (width == game->outputWidth && height == game->outputHeight && game->zoom == game->layoutZoom)) {
+        return;
+    }
+    game->outputWidth = width;
+    game->outputHeight = height;
+    game->layoutZoom = game->zoom;
+    float fit = SDL_min((float)width / game->sim.width, (float)height / game->sim.height);
+    if (fit >= 1.0f) fit = SDL_floorf(fit);
+    game->scale = fit * game->zoom;
+    game->camera = game->zoom > 1 || game->scale < LOD_SPRITE_CELL;
+    game->screenDirty = true;
+    if (game->camera) {
+        game->boardRect = (SDL_Rect){0, 0, width, height};
+    } else {
+        int boardWidth = game->sim.width * (int)game->scale;
+        int boardHeight = game->sim.height * (int)game->scale;
+        game->boardRect = (SDL_Rect){(width - boardWidth) / 2, (height - boardHeight) / 2, boardWidth, boardHeight};
+        game->origin = (SDL_FPoint){0.0f, 0.0f};
+        releaseCameraScratch(game);
+    }
+
+    int cellSize = game->scale < 1.0f ? 1 : (int)(game->scale + 0.5f);
+    bool cached = game->boardCached && !game->camera;
+    if (cellSize == game->cellSize && cached == (game->boardTexture != NULL)) {
+        return;
+    }
+    game->cellSize = cellSize;
+    game->boardStale = true;
+    if (game->boardTexture) {
+        SDL_DestroyTexture(game->boardTexture);
+        game->boardTexture = NULL;
+    }
+    if (cached) {
+        game->boardTexture = SDL_CreateTexture(game->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                               game->boardRect.w, game->boardRect.h);
+        SDL_SetTextureBlendMode(game->boardTexture, SDL_BLENDMODE_NONE);
+    }
+    // Sprites are only drawn at the highest detail level
+    if (game->scale >= LOD_SPRITE_CELL) {
+        requestRescale(game);
+    }
+}
+
+// Shows the measured tick and frame rates in the window title once per second.
+static void reportLoopStats(SnakeGame *game, Uint64 now) {
+    LoopStats *stats = &game->stats;
+    double elapsed = (double)(now - stats->start) / SDL_GetPerformanceFrequency();
+    if (elapsed < 1.0) {
+        return;
+    }
+    stats->tickRate = stats->ticks / elapsed;
+    stats->frameRate = stats->frames / elapsed;
+    stats->eventRate = stats->events / elapsed;
+    if (stats->inputs > 0) {
+        stats->inputLatency = (double)stats->inputLatencyTotal / stats->inputs;
+    }
+    char title[128];
+    snprintf(title, sizeof(title), "Snake - %.1f ticks/s, %.0f fps, input %.0f ms, %.0f events/s, %lu dropped",
+             stats->tickRate, stats->frameRate, stats->inputLatency, stats->eventRate, droppedEvents(game));
+    SDL_SetWindowTitle(game->window, title);
+    stats->start = now;
+    stats->ticks = 0;
+    stats->frames = 0;
+    stats->inputs = 0;
+    stats->inputLatencyTotal = 0;
+    stats->events = 0;
+}
+
+// Menu screens are static, so sleep until an event arrives and only redraw
+// when the screen content or the window changed.
+static void runMenuScreen(SnakeGame *game) {
+    if (game->screenDirty) {
+        if (game->gameState == START_SCREEN) {
+            renderStartScreen(game);
+        } else {
+            renderGameOverScreen(game);
+        }
+        game->screenDirty = false;
+    }
+    if (!SDL_WaitEventTimeout(NULL, MENU_WAIT_MS)) {
+        return;
+    }
+    if (game->gameState == START_SCREEN) {
+        handleStartScreenInput(game);
+    } else {
+        handleGameOverScreenInput(game);
+    }
+}
+
 void runGame(SnakeGame *game) {
+    Uint64 tickLength = SDL_GetPerformanceFrequency() / game->options.tickRate;
+    game->tickLength = tickLength;
+    Uint64 previous = SDL_GetPerformanceCounter();
+    GameState previousState = game->gameState;
+    game->screenDirty = true;
     while (game->running) {
+        collectRescale(game, false);
+        updateLayout(game);
+        Uint64 now = SDL_GetPerformanceCounter();
+        Uint64 elapsed = now - previous;
+        previous = now;
+        if (game->gameState != previousState) {
+            // Time spent on a menu does not count towards the next round
+            previousState = game->gameState;
+            game->screenDirty = true;
+            game->tickAccumulator = 0;
+            game->stats.start = now;
+            elapsed = 0;
+        }
         switch (game->gameState) {
             case START_SCREEN:
-                handleStartScreenInput(game);
-                renderStartScreen(game);
+            case GAME_OVER:
+                runMenuScreen(game);
                 break;
             case GAME_RUNNING:
                 handleInput(game);
-                update(game);
+                // Bound the catch-up so a stall does not fast-forward the game
+                game->tickAccumulator += elapsed;
+                if (game->tickAccumulator > MAX_CATCH_UP_TICKS * tickLength) {
+                    game->tickAccumulator = MAX_CATCH_UP_TICKS * tickLength;
+                }
+                while (game->tickAccumulator >= tickLength && game->gameState == GAME_RUNNING) {
+                    update(game);
+                    game->tickAccumulator -= tickLength;
+                    game->stats.ticks++;
+                }
+                consumeGameEvents(game);
                 render(game);
-                break;
-            case GAME_OVER:
-                handleGameOverScreenInput(game);
-                renderGameOverScreen(game);
+                game->stats.frames++;
+                reportLoopStats(game, now);
                 break;
         }
-        SDL_Delay(BASE_DELAY_MS);
     }
 }
 
-void initializeGame(SnakeGame *game) {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
-        printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
-        game->running = false;
+// Mixes the sounds recorded during a headless run and saves them as a WAV
+// file. The same run always produces the same samples.
+static void dumpAudio(SnakeGame *game, int frames) {
+    AudioMixer mixer;
+    if (!openOfflineMixer(&mixer, soundPaths)) {
         return;
     }
-    game->window = SDL_CreateWindow("Snake", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    if (!game->window) {
-        printf("Window could not be created! SDL Error: %s\n", SDL_GetError());
-        game->running = false;
+    Uint64 start = SDL_GetPerformanceCounter();
+    int16_t *pcm = renderAudioOffline(&mixer, game->audioTimeline, game->audioTimelineCount, frames);
+    Uint64 cost = SDL_GetPerformanceCounter() - start;
+    closeAudioMixer(&mixer);
+    if (!pcm) {
+        printf("Unable to allocate %d frames of audio!\n", frames);
         return;
     }
-    game->renderer = SDL_CreateRenderer(game->window, -1, SDL_RENDERER_ACCELERATED);
+    double seconds = (double)frames / MIXER_FREQUENCY;
+    double ms = cost * 1000.0 / SDL_GetPerformanceFrequency();
+    printf("Audio: %d sounds over %.1f s mixed in %.2f ms, %.0fx real time\n", game->audioTimelineCount,
+           seconds, ms, ms > 0 ? seconds * 1000.0 / ms : 0.0);
+    SDL_RWops *file = SDL_RWFromFile(game->options.dumpAudio, "wb");
+    if (!file || !writeWav(file, pcm, frames)) {
+        printf("Unable to save audio %s! SDL Error: %s\n", game->options.dumpAudio, SDL_GetError());
+    }
+    if (file) SDL_RWclose(file);
+    free(pcm);
+}
+
+// The text path render() used before the glyph atlas: rasterize, upload and
+// free a fresh texture on every call.
+static void renderTextUncached(SnakeGame *game, const char *text, int x, int y) {
+    SDL_Color color = {255, 255, 255, 255};
+    SDL_Surface *surface = game->options.blendedText ? TTF_RenderText_Blended(game->font, text, color)
+                                                     : TTF_RenderText_Solid(game->font, text, color);
+    if (!surface) {
+        return;
+    }
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(game->renderer, surface);
+    SDL_Rect destRect = {x, y, surface->w, surface->h};
+    SDL_RenderCopy(game->renderer, texture, NULL, &destRect);
+    SDL_FreeSurface(surface);
+    SDL_DestroyTexture(texture);
+}
+
+// Draws the game over screen's text for a fixed number of frames through
+// both paths, with a score that changes every frame like the real HUD.
+static void benchText(SnakeGame *game) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 costs[2] = {0, 0};
+    char scoreText[50];
+    for (int path = 0; path < 2; path++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < BENCH_TEXT_FRAMES; frame++) {
+            sprintf(scoreText, "Game Over! Score: %d", frame);
+            if (path == 0) {
+                renderText(game, scoreText, 10, 10);
+                renderText(game, "Press Enter to Restart", 10, 60);
+            } else {
+                renderTextUncached(game, scoreText, 10, 10);
+                renderTextUncached(game, "Press Enter to Restart", 10, 60);
+            }
+            SDL_RenderFlush(game->renderer);
+        }
+        costs[path] = SDL_GetPerformanceCounter() - start;
+    }
+    double toUs = 1000000.0 / frequency / BENCH_TEXT_FRAMES;
+    printf("Text, 2 lines per frame: glyph atlas %.1f us, TTF_RenderText_%s %.1f us (%.1fx)\n",
+           costs[0] * toUs, game->options.blendedText ? "Blended" : "Solid", costs[1] * toUs,
+           costs[0] > 0 ? (double)costs[1] / costs[0] : 0.0);
+}
+
+// Plays a reproducible round offscreen, steered by the greedy policy, and
+// times every render() call. Frames advance a virtual clock so the tick and
+// interpolation pattern is the same on every machine.
+void runHeadless(SnakeGame *game) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 tickLength = frequency / game->options.tickRate;
+    Uint64 frameLength = frequency / HEADLESS_FRAME_RATE;
+    uint64_t policyRng = HEADLESS_SEED;
+    Uint64 total = 0;
+    Uint64 fastest = (Uint64)-1;
+    Uint64 slowest = 0;
+    int frames = 0;
+    int ticks = 0;
+    int rounds = 1;
+    game->tickLength = tickLength;
+    game->gameState = GAME_RUNNING;
+    // Time only steady-state frames, with every asset already at its final size
+    updateLayout(game);
+    collectRescale(game, true);
+    snakeReset(&game->sim, HEADLESS_SEED);
+    game->previousTail = snakeSegment(&game->sim, game->sim.length - 1);
+    game->boardStale = true;
+    for (; frames < game->options.headlessFrames && game->running; frames++) {
+        handleInput(game);
+        game->tickAccumulator += frameLength;
+        while (game->tickAccumulator >= tickLength) {
+            SnakeView view = {snakeSegment(&game->sim, 0), game->sim.food, game->sim.direction,
+                              game->sim.width, game->sim.height, game->sim.occupancy};
+            queueTurn(game, snakeGreedyPolicy(&view, &policyRng, NULL), SDL_GetTicks());
+            update(game);
+            game->tickAccumulator -= tickLength;
+            ticks++;
+            if (game->gameState == GAME_OVER) {
+                snakeReset(&game->sim, HEADLESS_SEED + rounds++);
+                game->previousTail = snakeSegment(&game->sim, game->sim.length - 1);
+                game->boardStale = true;
+                game->gameState = GAME_RUNNING;
+            }
+        }
+        game->audioClock = (int)((long long)frames * MIXER_FREQUENCY / HEADLESS_FRAME_RATE);
+        consumeGameEvents(game);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        render(game);
+        Uint64 cost = SDL_GetPerformanceCounter() - start;
+        total += cost;
+        if (cost < fastest) fastest = cost;
+        if (cost > slowest) slowest = cost;
+
+        if (game->options.dumpPrefix) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s%05d.bmp", game->options.dumpPrefix, frames);
+            if (SDL_SaveBMP(game->offscreen, path) != 0) {
+                printf("Unable to save frame %s! SDL Error: %s\n", path, SDL_GetError());
+                game->options.dumpPrefix = NULL;
+            }
+        }
+    }
+    if (frames == 0) {
+        return;
+    }
+    double toMs = 1000.0 / frequency;
+    printf("Rendered %d frames, %d ticks, %d rounds\n", frames, ticks, rounds);
+    printf("render(): %.3f ms avg, %.3f ms min, %.3f ms max, %.0f frames/s\n",
+           total * toMs / frames, fastest * toMs, slowest * toMs,
+           total > 0 ? frames * (double)frequency / total : 0.0);
+    long long *counts = game->stats.eventCounts;
+    printf("Events: %lld ate, %lld died, %lld turned, %lld won, %lu dropped\n", counts[GAME_EVENT_ATE],
+           counts[GAME_EVENT_DIED], counts[GAME_EVENT_TURNED], counts[GAME_EVENT_WON], droppedEvents(game));
+    if (game->options.benchText) {
+        benchText(game);
+    }
+    if (game->options.dumpAudio) {
+        dumpAudio(game, (int)((long long)frames * MIXER_FREQUENCY / HEADLESS_FRAME_RATE));
+    }
+}
+
+// Watches many bot games tiled into the window. Headless, it renders a fixed
+// number of frames on the virtual clock and prints the average frame cost.
+void runSpectator(SnakeGame *game) {
+    Spectator spectator;
+    if (!spectatorInit(&spectator, game->options.spectateBoards, game->options.boardWidth, game->options.boardHeight, CELL_SIZE,
+                       &game->sprites, (uint64_t)time(NULL), 0)) {
+        return;
+    }
+    bool headless = game->options.headlessFrames > 0;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 tickLength = frequency / game->options.tickRate;
+    Uint64 previous = SDL_GetPerformanceCounter();
+    Uint64 busy = 0;
+    int frames = 0;
+    game->stats.start = previous;
+    while (game->running && (!headless || frames < game->options.headlessFrames)) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
+                game->running = false;
+            }
+        }
+        Uint64 now = SDL_GetPerformanceCounter();
+        game->tickAccumulator += headless ? frequency / HEADLESS_FRAME_RATE : now - previous;
+        previous = now;
+        if (game->tickAccumulator > MAX_CATCH_UP_TICKS * tickLength) {
+            game->tickAccumulator = MAX_CATCH_UP_TICKS * tickLength;
+        }
+        int ticks = (int)(game->tickAccumulator / tickLength);
+        game->tickAccumulator -= ticks * tickLength;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (ticks > 0) {
+            spectatorStep(&spectator, ticks);
+        }
+        spectatorRender(&spectator, game->renderer, game->backgroundTexture);
+        SDL_RenderPresent(game->renderer);
+        busy += SDL_GetPerformanceCounter() - start;
+        frames++;
+        game->stats.ticks += ticks;
+        game->stats.frames++;
+        if (!headless) {
+            reportLoopStats(game, now);
+        }
+    }
+    if (headless && frames > 0) {
+        printf("Spectated %d boards on %d threads: %.3f ms per frame, %.0f frames/s\n",
+               spectator.boards, spectator.threadCount, busy * 1000.0 / frequency / frames,
+               busy > 0 ? frames * (double)frequency / busy : 0.0);
+    }
+    spectatorFree(&spectator);
+}
+
+// Window and renderer, or the offscreen surface and software renderer when headless.
+static bool createRenderer(SnakeGame *game, bool headless) {
+    if (headless) {
+        // Same renderer API and render path, drawn by SDL's software renderer into memory
+        game->offscreen = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!game->offscreen) {
+            printf("Offscreen surface could not be created! SDL Error: %s\n", SDL_GetError());
+            return false;
+        }
+        game->renderer = SDL_CreateSoftwareRenderer(game->offscreen);
+    } else {
+        game->window = SDL_CreateWindow("Snake", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT,
+                                        SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+        if (!game->window) {
+            printf("Window could not be created! SDL Error: %s\n", SDL_GetError());
+            return false;
+        }
+        Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+        if (game->options.vsync) {
+            rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+        }
+        game->renderer = SDL_CreateRenderer(game->window, -1, rendererFlags);
+    }
     if (!game->renderer) {
         printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+// Every file read at startup, in the order the loader threads pick them up
+enum {
+    BACKGROUND_ASSET,
+    FIRST_SPRITE_ASSET,
+    FIRST_SOUND_ASSET = FIRST_SPRITE_ASSET + SPRITE_COUNT,
+    FONT_ASSET = FIRST_SOUND_ASSET + SOUND_COUNT,
+    STARTUP_ASSETS
+};
+
+static void describeAssets(SnakeGame *game, Asset assets[STARTUP_ASSETS]) {
+    static const char *spritePaths[SPRITE_COUNT] = {
+        [SPRITE_HEAD] = "assets/default_textures/snake/head.png",
+        [SPRITE_BODY] = "assets/default_textures/snake/body.png",
+        [SPRITE_TAIL] = "assets/default_textures/snake/tail.png",
+        [SPRITE_TURN] = "assets/default_textures/snake/turn.png",
+        [SPRITE_APPLE] = "assets/default_textures/apple/apple.png",
+    };
+    memset(assets, 0, sizeof(Asset) * STARTUP_ASSETS);
+    assets[BACKGROUND_ASSET] = (Asset){.kind = ASSET_IMAGE, .path = "assets/default_textures/background/background.png"};
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        assets[FIRST_SPRITE_ASSET + i] = (Asset){.kind = ASSET_IMAGE, .path = spritePaths[i]};
+    }
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        AssetKind kind = game->options.audioSamples > 0 ? ASSET_PCM : ASSET_CHUNK;
+        assets[FIRST_SOUND_ASSET + i] = (Asset){.kind = kind, .path = soundPaths[i]};
+    }
+    assets[FONT_ASSET] = (Asset){.kind = ASSET_FONT, .path = "assets/default_textures/fonts/OpenSans-Regular.ttf", .fontSize = FONT_SIZE};
+}
+
+// Hands the decoded assets to their owners and uploads what the renderer
+// needs. Whatever is still left in assets afterwards belongs to the caller.
+static bool useAssets(SnakeGame *game, Asset assets[STARTUP_ASSETS]) {
+    game->backgroundSource = assets[BACKGROUND_ASSET].surface;
+    assets[BACKGROUND_ASSET].surface = NULL;
+    game->font = assets[FONT_ASSET].font;
+    assets[FONT_ASSET].font = NULL;
+
+    if (game->options.audioSamples > 0) {
+        MixerSound sounds[SOUND_COUNT];
+        for (int i = 0; i < SOUND_COUNT; i++) {
+            sounds[i] = assets[FIRST_SOUND_ASSET + i].pcm;
+            assets[FIRST_SOUND_ASSET + i].pcm = (MixerSound){NULL, 0};
+        }
+        if (!openAudioMixer(&game->mixer, sounds, game->options.audioSamples)) {
+            return false;
+        }
+    } else {
+        Mix_Chunk *chunks[SOUND_COUNT];
+        for (int i = 0; i < SOUND_COUNT; i++) {
+            chunks[i] = assets[FIRST_SOUND_ASSET + i].chunk;
+            assets[FIRST_SOUND_ASSET + i].chunk = NULL;
+        }
+        if (!createSoundBank(&game->sounds, chunks, SOUND_CHANNELS)) {
+            return false;
+        }
+    }
+
+    SDL_Surface *sprites[SPRITE_COUNT];
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        sprites[i] = assets[FIRST_SPRITE_ASSET + i].surface;
+        assets[FIRST_SPRITE_ASSET + i].surface = NULL;
+    }
+    // Every cell, plus the extra head, tail and fill copies drawn while interpolating
+    int boardCells = game->options.boardWidth * game->options.boardHeight;
+    if (!createSpriteAtlas(&game->sprites, game->renderer, sprites, SDL_min(boardCells, MAX_SPRITE_BATCH) + 8)) {
+        return false;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    game->backgroundTexture = SDL_CreateTextureFromSurface(game->renderer, game->backgroundSource);
+    assets[BACKGROUND_ASSET].uploadTime = SDL_GetPerformanceCounter() - start;
+    start = SDL_GetPerformanceCounter();
+    if (!createGlyphAtlas(&game->textAtlas, game->renderer, game->font, game->options.blendedText)) {
+        return false;
+    }
+    assets[FONT_ASSET].uploadTime = SDL_GetPerformanceCounter() - start;
+    return true;
+}
+
+void initializeGame(SnakeGame *game) {
+    bool headless = game->options.headlessFrames > 0;
+    if (headless) {
+        // Build boxes usually have no sound card either
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+    }
+    if (SDL_Init((headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO) | SDL_INIT_AUDIO) < 0) {
+        printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
         game->running = false;
         return;
     }
@@ -382,45 +1163,92 @@ void initializeGame(SnakeGame *game) {
         game->running = false;
         return;
     }
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+    // Chunks are converted to the device format while decoding, so the device opens first
+    if (game->options.audioSamples <= 0 && Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
         printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
         game->running = false;
         return;
     }
-    game->backgroundTexture = loadTexture(game, "assets/default_textures/background/background.png");
-    game->headTexture = loadTexture(game, "assets/default_textures/snake/head.png");
-    game->bodyTexture = loadTexture(game, "assets/default_textures/snake/body.png");
-    game->tailTexture = loadTexture(game, "assets/default_textures/snake/tail.png");
-    game->turnTexture = loadTexture(game, "assets/default_textures/snake/turn.png");
-    game->appleTexture = loadTexture(game, "assets/default_textures/apple/apple.png");
-    game->font = TTF_OpenFont("assets/default_textures/fonts/OpenSans-Regular.ttf", FONT_SIZE);
-    if (!game->font) {
-        printf("Failed to load font! SDL_ttf Error: %s\n", TTF_GetError());
+
+    // Decode on worker threads while this thread creates the window and renderer
+    Asset assets[STARTUP_ASSETS];
+    describeAssets(game, assets);
+    AssetLoader loader;
+    startAssetLoader(&loader, assets, STARTUP_ASSETS, 0);
+    bool rendererReady = createRenderer(game, headless);
+    bool decoded = finishAssetLoader(&loader);
+    bool ready = rendererReady && decoded && useAssets(game, assets);
+    freeAssets(assets, STARTUP_ASSETS);
+    if (!ready) {
+        game->running = false;
+        return;
+    }
+    if (headless) {
+        reportAssets(&loader);
+        printf("Sprite atlas: %d variants of %dx%d in %.2f ms\n", SPRITE_COUNT * CELL_ORIENTATIONS,
+               game->sprites.tileSize, game->sprites.tileSize,
+               game->sprites.buildTime * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+
+    bool cpuBlit = headless && game->options.cpuBlitThreads > 0;
+    if (cpuBlit && (game->options.boardWidth != GRID_WIDTH || game->options.boardHeight != GRID_HEIGHT)) {
+        // Its tiles are fixed at CELL_SIZE, which only matches the default board
+        printf("CPU blitter needs the default %dx%d board, using the renderer instead\n", GRID_WIDTH, GRID_HEIGHT);
+        cpuBlit = false;
+    }
+    // The CPU blitter writes straight into the offscreen surface, so it redraws the whole board each frame
+    game->boardCached = !cpuBlit && SDL_RenderTargetSupported(game->renderer);
+    game->boardStale = true;
+    if (cpuBlit) {
+        if (!useCpuBlitter(&game->sprites, game->offscreen, CELL_SIZE, game->options.cpuBlitThreads)) {
+            game->running = false;
+            return;
+        }
+        static const char *kernels[] = {"scalar", "SSE4.1", "AVX2"};
+        printf("CPU blitter: %s kernel, %d row bands\n", kernels[game->sprites.blitter.kernel], game->sprites.blitter.bands);
+    }
+    if (!snakeInit(&game->sim, game->options.boardWidth, game->options.boardHeight, (uint64_t)time(NULL))) {
+        printf("Failed to create a %dx%d board!\n", game->options.boardWidth, game->options.boardHeight);
+        game->running = false;
+        return;
+    }
+    if (!eventQueueInit(&game->audioEvents, EVENT_QUEUE_SIZE) || !eventQueueInit(&game->statsEvents, EVENT_QUEUE_SIZE)) {
+        printf("Failed to allocate event queues!\n");
         game->running = false;
         return;
     }
+    game->previousTail = snakeSegment(&game->sim, game->sim.length - 1);
     game->running = true;
     game->gameState = START_SCREEN;
-    game->score = 0;
-    game->snakeLength = INITIAL_LENGTH;
-    game->direction = RIGHT;
-    for (int i = 0; i < INITIAL_LENGTH; i++) {
-        game->snake[i] = (Point){(INITIAL_LENGTH - i - 1) * CELL_SIZE, 0};
+    game->zoom = 1;
+    // The spectator lays out its own tiles and draws the sprites at their loaded size
+    if (game->options.spectateBoards == 0) {
+        updateLayout(game);
     }
-    srand((unsigned int)time(NULL));
-    generateFood(game);
 }
 
 void cleanupGame(SnakeGame *game) {
+    finishAssetScaler(&game->scaler);
+    SDL_FreeSurface(game->scaler.background);
+    SDL_FreeSurface(game->scaler.spriteSheet);
+    SDL_FreeSurface(game->backgroundSource);
+    snakeFree(&game->sim);
+    eventQueueFree(&game->audioEvents);
+    eventQueueFree(&game->statsEvents);
+    free(game->audioTimeline);
     SDL_DestroyTexture(game->backgroundTexture);
-    SDL_DestroyTexture(game->headTexture);
-    SDL_DestroyTexture(game->bodyTexture);
-    SDL_DestroyTexture(game->tailTexture);
-    SDL_DestroyTexture(game->turnTexture);
-    SDL_DestroyTexture(game->appleTexture);
+    SDL_DestroyTexture(game->boardTexture);
+    releaseCameraScratch(game);
+    destroySpriteAtlas(&game->sprites);
+    destroyGlyphAtlas(&game->textAtlas);
     TTF_CloseFont(game->font);
     SDL_DestroyRenderer(game->renderer);
-    SDL_DestroyWindow(game->window);
+    if (game->window) SDL_DestroyWindow(game->window);
+    SDL_FreeSurface(game->offscreen);
+    reportAudioMixer(&game->mixer);
+    closeAudioMixer(&game->mixer);
+    destroySoundBank(&game->sounds);
+    Mix_CloseAudio();
     Mix_Quit();
     TTF_Quit();
     IMG_Quit();
@@ -6,13 +6,36 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_mixer.h>
 #include <stdbool.h>
+#include "snake_core.h"
+#include "glyph_atlas.h"
+#include "sprite_atlas.h"
+#include "snake_pool.h"
+#include "spectator.h"
+#include "asset_scaler.h"
+#include "asset_loader.h"
+#include "sound_bank.h"
+#include "audio_mixer.h"
+#include "event_queue.h"
 
+// Window size and cell size the game opens with; both follow the window afterwards
 #define SCREEN_WIDTH 640
 #define SCREEN_HEIGHT 480
 #define CELL_SIZE 40
-#define INITIAL_LENGTH 3
 #define FONT_SIZE 24
 #define BASE_DELAY_MS 200
+#define GRID_WIDTH (SCREEN_WIDTH / CELL_SIZE)   // default board size in cells
+#define GRID_HEIGHT (SCREEN_HEIGHT / CELL_SIZE)
+#define LOD_SPRITE_CELL 8    // below this many pixels per cell, cells are flat rects
+#define LOD_RECT_CELL 2      // below this, the board is streamed as a texture
+#define MAX_CELL_SIZE 128    // zooming in stops here
+#define MAX_SPRITE_BATCH 4096
+#define MAX_CATCH_UP_TICKS 5
+#define INPUT_QUEUE_SIZE 4
+#define EVENT_QUEUE_SIZE 256 // per consumer, a few seconds of events at any tick rate
+#define MENU_WAIT_MS 1000
+#define HEADLESS_FRAME_RATE 60
+#define HEADLESS_SEED 1
+#define BENCH_TEXT_FRAMES 2000
 
 typedef enum {
     START_SCREEN,
@@ -21,36 +44,96 @@ typedef enum {
 } GameState;
 
 typedef struct {
-    int x;
-    int y;
-} Point;
+    bool vsync;
+    bool blendedText;
+    int tickRate; // simulation ticks per second
+    int boardWidth;         // in cells
+    int boardHeight;
+    int audioSamples;       // > 0 mixes sound in our own callback with buffers this long
+    int headlessFrames;     // > 0 renders this many frames offscreen and exits
+    const char *dumpPrefix; // headless only, saves every frame as <prefix>NNNNN.bmp
+    const char *dumpAudio;  // headless only, renders the run's sound offline into this WAV file
+    int cpuBlitThreads;     // headless only, > 0 blends sprites with the CPU blitter
+    bool benchText;         // headless only, times the glyph atlas against per-call TTF rendering
+    int spectateBoards;     // > 0 watches this many bot games instead of playing
+} GameOptions;
 
-typedef enum {
-    UP,
-    RIGHT,
-    DOWN,
-    LEFT
-} Direction;
+// A requested turn, applied on a later tick.
+typedef struct {
+    Direction direction;
+    Uint32 timestamp; // SDL event timestamp in milliseconds
+} InputIntent;
+
+typedef struct {
+    InputIntent intents[INPUT_QUEUE_SIZE];
+    int head;
+    int count;
+} InputQueue;
 
+// Tick and frame counters, turned into rates once per second.
 typedef struct {
+    Uint64 start;
+    int ticks;
+    int frames;
+    int inputs;
+    Uint32 inputLatencyTotal;
+    double tickRate;
+    double frameRate;
+    double inputLatency; // average milliseconds from key press to applied turn
+    int events;          // game events consumed since start
+    double eventRate;
+    long long eventCounts[GAME_EVENT_TYPES]; // since the game started
+} LoopStats;
+
+typedef struct {
+    GameOptions options;
     SDL_Window *window;
     SDL_Renderer *renderer;
+    SDL_Surface *offscreen; // software render target when headless, no window
+    SDL_Surface *backgroundSource; // decoded background, resampled on resize
     SDL_Texture *backgroundTexture;
-    SDL_Texture *headTexture;
-    SDL_Texture *bodyTexture;
-    SDL_Texture *tailTexture;
-    SDL_Texture *turnTexture;
-    SDL_Texture *appleTexture;
+    SDL_Texture *boardTexture; // background, food and body, patched per tick
+    bool boardCached;          // render targets work, so boardTexture is used
+    bool boardStale;           // boardTexture must be redrawn from scratch
+    int cellSize;              // sprite tile size for the current scale
+    float scale;               // pixels per cell, fractional on huge boards
+    int zoom;                  // 1 fits the whole board, each step doubles the scale
+    int layoutZoom;            // zoom the layout was computed for
+    bool camera;               // zoomed or too small for sprites: draw only visible cells
+    SDL_FPoint origin;         // board pixel at the top-left corner of boardRect
+    SDL_Rect boardRect;        // where the board sits in the renderer output
+    int outputWidth;
+    int outputHeight;
+    SDL_Texture *cellTexture;  // lowest detail, streamed from the occupancy grid
+    int cellTextureWidth;
+    int cellTextureHeight;
+    SDL_FRect *cellRects;      // scratch for the flat-rect detail level
+    int cellRectCapacity;
+    AssetScaler scaler;        // background and sprites being resampled for cellSize
+    SpriteAtlas sprites; // head, body, tail, turn and apple
+    SoundBank sounds;          // SDL_mixer backend
+    AudioMixer mixer;          // custom callback backend, used when its device is open
     TTF_Font *font;
-    Point snake[SCREEN_WIDTH * SCREEN_HEIGHT / (CELL_SIZE * CELL_SIZE)];
-    int snakeLength;
-    Point food;
-    Direction direction;
-    int score;
+    GlyphAtlas textAtlas;
+    SnakeState sim;
     bool running;
     GameState gameState;
+    Uint64 tickAccumulator; // performance counter units not yet simulated
+    Uint64 tickLength;
+    Point previousTail;     // tail cell before the last tick, for interpolation
+    InputQueue input;
+    EventQueue audioEvents; // published by update(), consumed once per frame
+    EventQueue statsEvents;
+    int audioClock;         // headless audio frame the current events happened on
+    TimedSound *audioTimeline; // sounds recorded for --dump-audio
+    int audioTimelineCount;
+    int audioTimelineCapacity;
+    bool screenDirty;       // menu screens redraw only when this is set
+    LoopStats stats;
 } SnakeGame;
 
+bool parseGameOptions(GameOptions *options, int argc, char* argv[]);
+
 void initializeGame(SnakeGame *game);
 void cleanupGame(SnakeGame *game);
 void handleInput(SnakeGame *game);
@@ -61,5 +144,7 @@ void renderGameOverScreen(SnakeGame *game);
 void handleStartScreenInput(SnakeGame *game);
 void handleGameOverScreenInput(SnakeGame *game);
 void runGame(SnakeGame *game);
+void runHeadless(SnakeGame *game);
+void runSpectator(SnakeGame *game);
 
 #endif // GAME_H
@@ -0,0 +1,125 @@
+#include "glyph_atlas.h"
+#include "sprite_atlas.h"
+#include <stdio.h>
+#include <string.h>
+
+// Rasterizes every glyph once, packs them into rows of one texture and
+// caches advances and kerning so drawing text never touches SDL_ttf.
+bool createGlyphAtlas(GlyphAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font, bool blended) {
+    memset(atlas, 0, sizeof(*atlas));
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *rendered[GLYPH_COUNT] = {NULL};
+
+    // Lay the glyphs out in rows before allocating the atlas surface
+    int penX = 0;
+    int penY = 0;
+    int rowHeight = 0;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        Uint16 ch = (Uint16)(GLYPH_FIRST + i);
+        int advance = 0;
+        TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &advance);
+        atlas->glyphs[i].advance = advance;
+        rendered[i] = blended ? TTF_RenderGlyph_Blended(font, ch, white) : TTF_RenderGlyph_Solid(font, ch, white);
+        if (!rendered[i]) {
+            continue;
+        }
+        if (penX + rendered[i]->w + 1 > GLYPH_ATLAS_WIDTH) {
+            penX = 0;
+            penY += rowHeight + 1;
+            rowHeight = 0;
+        }
+        atlas->glyphs[i].source = (SDL_Rect){penX, penY, rendered[i]->w, rendered[i]->h};
+        penX += rendered[i]->w + 1;
+        if (rendered[i]->h > rowHeight) rowHeight = rendered[i]->h;
+    }
+    atlas->width = GLYPH_ATLAS_WIDTH;
+    atlas->height = penY + rowHeight;
+    atlas->lineHeight = TTF_FontLineSkip(font);
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, atlas->width, atlas->height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+        printf("Unable to create glyph atlas! SDL Error: %s\n", SDL_GetError());
+        for (int i = 0; i < GLYPH_COUNT; i++) SDL_FreeSurface(rendered[i]);
+        return false;
+    }
+    SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 255, 255, 255, 0));
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        if (!rendered[i]) {
+            continue;
+        }
+        // Copy alpha as-is; solid glyphs keep their colour key as transparency
+        SDL_SetSurfaceBlendMode(rendered[i], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(rendered[i], NULL, surface, &atlas->glyphs[i].source);
+        SDL_FreeSurface(rendered[i]);
+    }
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (!atlas->texture) {
+        printf("Unable to create glyph atlas texture! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+
+    for (int a = 0; a < GLYPH_COUNT; a++) {
+        for (int b = 0; b < GLYPH_COUNT; b++) {
+            atlas->kerning[a][b] = (Sint8)TTF_GetFontKerningSizeGlyphs(font, (Uint16)(GLYPH_FIRST + a), (Uint16)(GLYPH_FIRST + b));
+        }
+    }
+    fillQuadIndices(atlas->indices, GLYPH_BATCH);
+    return true;
+}
+
+void destroyGlyphAtlas(GlyphAtlas *atlas) {
+    if (atlas->texture) {
+        SDL_DestroyTexture(atlas->texture);
+        atlas->texture = NULL;
+    }
+}
+
+// Emits one textured quad per glyph and submits them in batches of
+// GLYPH_BATCH, so a whole line of text is usually a single draw call.
+void drawText(GlyphAtlas *atlas, SDL_Renderer *renderer, const char *text, int x, int y, SDL_Color color) {
+    if (!atlas->texture) {
+        return;
+    }
+    float invWidth = 1.0f / atlas->width;
+    float invHeight = 1.0f / atlas->height;
+    int quads = 0;
+    int penX = x;
+    int previous = -1;
+    for (const char *c = text; *c; c++) {
+        int index = (unsigned char)*c - GLYPH_FIRST;
+        if (index < 0 || index >= GLYPH_COUNT) {
+            previous = -1;
+            continue;
+        }
+        if (previous >= 0) {
+            penX += atlas->kerning[previous][index];
+        }
+        const Glyph *glyph = &atlas->glyphs[index];
+        if (glyph->source.w > 0) {
+            float left = (float)penX;
+            float top = (float)y;
+            float right = left + glyph->source.w;
+            float bottom = top + glyph->source.h;
+            float u0 = glyph->source.x * invWidth;
+            float v0 = glyph->source.y * invHeight;
+            float u1 = (glyph->source.x + glyph->source.w) * invWidth;
+            float v1 = (glyph->source.y + glyph->source.h) * invHeight;
+            SDL_Vertex *v = &atlas->vertices[quads * 4];
+            v[0] = (SDL_Vertex){{left, top}, color, {u0, v0}};
+            v[1] = (SDL_Vertex){{right, top}, color, {u1, v0}};
+            v[2] = (SDL_Vertex){{left, bottom}, color, {u0, v1}};
+            v[3] = (SDL_Vertex){{right, bottom}, color, {u1, v1}};
+            if (++quads == GLYPH_BATCH) {
+                SDL_RenderGeometry(renderer, atlas->texture, atlas->vertices, quads * 4, atlas->indices, quads * 6);
+                quads = 0;
+            }
+        }
+        penX += glyph->advance;
+        previous = index;
+    }
+    if (quads > 0) {
+        SDL_RenderGeometry(renderer, atlas->texture, atlas->vertices, quads * 4, atlas->indices, quads * 6);
+    }
+}
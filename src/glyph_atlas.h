@@ -0,0 +1,36 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+
+// Printable ASCII, rasterized once into a single texture
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define GLYPH_BATCH 128
+#define GLYPH_ATLAS_WIDTH 512
+
+typedef struct {
+    SDL_Rect source; // location in the atlas texture
+    int advance;
+} Glyph;
+
+typedef struct {
+    SDL_Texture *texture;
+    int width;
+    int height;
+    int lineHeight;
+    Glyph glyphs[GLYPH_COUNT];
+    Sint8 kerning[GLYPH_COUNT][GLYPH_COUNT];
+    // Scratch geometry reused by every draw call
+    SDL_Vertex vertices[GLYPH_BATCH * 4];
+    int indices[GLYPH_BATCH * 6];
+} GlyphAtlas;
+
+bool createGlyphAtlas(GlyphAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font, bool blended);
+void destroyGlyphAtlas(GlyphAtlas *atlas);
+void drawText(GlyphAtlas *atlas, SDL_Renderer *renderer, const char *text, int x, int y, SDL_Color color);
+
+#endif // GLYPH_ATLAS_H
@@ -1,9 +1,16 @@
 #include "game.h"
 
 int main(int argc, char* argv[]) {
-    SnakeGame game;
+    SnakeGame game = {0};
+    if (!parseGameOptions(&game.options, argc, argv)) {
+        return 1;
+    }
     initializeGame(&game);
-    if (game.running) {
+    if (game.running && game.options.spectateBoards > 0) {
+        runSpectator(&game);
+    } else if (game.running && game.options.headlessFrames > 0) {
+        runHeadless(&game);
+    } else if (game.running) {
         runGame(&game);
     }
     cleanupGame(&game);
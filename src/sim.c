@@ -0,0 +1,131 @@
+#include "snake_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_BOARD 1000     // cells per side, room for a 100k snake and the timed ticks
+#define BENCH_TICKS 200000
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Sweeps the board row by row, alternating direction, so the snake never
+// runs into itself before it has covered the whole board.
+static Direction serpentine(Point head, int width) {
+    if (head.y % 2 == 0) {
+        return head.x == width - 1 ? DOWN : RIGHT;
+    }
+    return head.x == 0 ? DOWN : LEFT;
+}
+
+// Times snakeStep() at a few fixed snake lengths: the snake is fed up to
+// each length along a serpentine path, then stepped without food.
+static int benchStep(void) {
+    static const int lengths[] = {INITIAL_LENGTH, 1000, 100000};
+    SnakeState state;
+    if (!snakeInit(&state, BENCH_BOARD, BENCH_BOARD, 1)) {
+        printf("Unable to allocate the benchmark board!\n");
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        snakeReset(&state, 1);
+        while (state.length < lengths[i]) {
+            Point head = snakeSegment(&state, 0);
+            snakeTurn(&state, serpentine(head, state.width));
+            state.food = snakeNeighbour(head, state.direction, state.width, state.height);
+            snakeStep(&state);
+        }
+        int length = state.length;
+        double start = nowSeconds();
+        for (int tick = 0; tick < BENCH_TICKS; tick++) {
+            snakeTurn(&state, serpentine(snakeSegment(&state, 0), state.width));
+            snakeStep(&state);
+        }
+        double seconds = nowSeconds() - start;
+        if (state.status != SNAKE_ALIVE) {
+            printf("Benchmark snake died at length %d!\n", length);
+            snakeFree(&state);
+            return 1;
+        }
+        printf("length %6d: %.1f ns per snakeStep()\n", length, seconds * 1e9 / BENCH_TICKS);
+    }
+    snakeFree(&state);
+    return 0;
+}
+
+// Headless driver: plays a batch of games on the work-stealing pool and
+// reports throughput. Needs nothing but the core library and pthreads.
+int main(int argc, char* argv[]) {
+    SnakeWorkload work = {0};
+    work.games = 100000;
+    work.width = 16;
+    work.height = 12;
+    work.seed = 1;
+    int threads = 0;
+    bool boardParsed = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            work.games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            boardParsed = sscanf(argv[++i], "%dx%d", &work.width, &work.height) == 2;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            work.maxTicks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            work.chunkSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            work.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            work.batched = true;
+        } else if (strcmp(argv[i], "--bench-step") == 0) {
+            return benchStep();
+        } else {
+            printf("Usage: %s [--games N] [--threads N] [--board WxH] [--ticks N] [--chunk N] [--seed N] [--batch] [--bench-step]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (work.games <= 0) {
+        printf("--games must be at least 1!\n");
+        return 1;
+    }
+    if (threads < 0) {
+        printf("--threads must be 0 (one per core) or more!\n");
+        return 1;
+    }
+    if (!boardParsed || work.width <= 0 || work.height <= 0) {
+        printf("--board must be two positive sizes like 16x12!\n");
+        return 1;
+    }
+    if (work.maxTicks < 0) {
+        printf("--ticks must be 0 (play every game out) or more!\n");
+        return 1;
+    }
+    if (work.chunkSize < 0) {
+        printf("--chunk must be 0 (default size) or more!\n");
+        return 1;
+    }
+
+    SnakePool *pool = snakePoolCreate(threads);
+    if (!pool) {
+        printf("Could not start the simulation thread pool!\n");
+        return 1;
+    }
+    SnakePoolStats stats;
+    if (!snakePoolRun(pool, &work, &stats)) {
+        printf("Simulation failed, check the board size!\n");
+        snakePoolDestroy(pool);
+        return 1;
+    }
+    printf("%lld games, %lld ticks on %d threads in %.3f s (%lld steals)\n",
+           stats.games, stats.ticks, pool->threadCount, stats.seconds, stats.steals);
+    printf("%.0f games/s, %.0f ticks/s\n", stats.gamesPerSecond, stats.ticksPerSecond);
+    printf("total score %lld, %lld wins\n", stats.totalScore, stats.wins);
+    snakePoolDestroy(pool);
+    return 0;
+}
@@ -0,0 +1,320 @@
+#include "snake_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SNAKE_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+// Kernel output flags, only meaningful for games that are still alive
+#define NEXT_ATE 1
+#define NEXT_DIED 2
+
+static void setOccupied(SnakeBatch *batch, int game, int cell, bool occupied) {
+    uint32_t *words = batch->occupancy + (size_t)game * batch->words;
+    int32_t *freeCells = batch->freeCells + (size_t)game * batch->cellCount;
+    int32_t *freeSlot = batch->freeSlot + (size_t)game * batch->cellCount;
+    uint32_t bit = 1u << (cell % 32);
+    if (((words[cell / 32] & bit) != 0) == occupied) {
+        return;
+    }
+    if (occupied) {
+        // Swap the last free cell into the vacated slot, exactly like snake_core.c
+        int slot = freeSlot[cell];
+        int last = freeCells[--batch->freeCount[game]];
+        freeCells[slot] = last;
+        freeSlot[last] = slot;
+        words[cell / 32] |= bit;
+    } else {
+        freeCells[batch->freeCount[game]] = cell;
+        freeSlot[cell] = batch->freeCount[game]++;
+        words[cell / 32] &= ~bit;
+    }
+}
+
+static void pushHead(SnakeBatch *batch, int game, int x, int y, int cell) {
+    int32_t head = batch->bodyHead[game];
+    head = head == 0 ? batch->cellCount - 1 : head - 1;
+    batch->bodyHead[game] = head;
+    batch->body[(size_t)game * batch->cellCount + head] = cell;
+    batch->headX[game] = x;
+    batch->headY[game] = y;
+    batch->headCell[game] = cell;
+    batch->length[game]++;
+    setOccupied(batch, game, cell, true);
+}
+
+static void popTail(SnakeBatch *batch, int game) {
+    setOccupied(batch, game, batch->tailCell[game], false);
+    int length = --batch->length[game];
+    int slot = batch->bodyHead[game] + length - 1;
+    if (slot >= batch->cellCount) slot -= batch->cellCount;
+    batch->tailCell[game] = batch->body[(size_t)game * batch->cellCount + slot];
+}
+
+static bool placeFood(SnakeBatch *batch, int game) {
+    int32_t freeCount = batch->freeCount[game];
+    if (freeCount == 0) {
+        return false;
+    }
+    uint32_t pick = snakeRandomStream(&batch->rng[game], (uint32_t)freeCount);
+    batch->foodCell[game] = batch->freeCells[(size_t)game * batch->cellCount + pick];
+    return true;
+}
+
+bool snakeBatchInit(SnakeBatch *batch, int count, int width, int height, uint64_t seed) {
+    memset(batch, 0, sizeof(*batch));
+    if (count <= 0 || width <= INITIAL_LENGTH || height <= 0) {
+        return false;
+    }
+    batch->count = count;
+    batch->lanes = (count + SNAKE_BATCH_LANES - 1) / SNAKE_BATCH_LANES * SNAKE_BATCH_LANES;
+    batch->width = width;
+    batch->height = height;
+    batch->cellCount = width * height;
+    batch->words = (batch->cellCount + 31) / 32;
+    batch->kernel = snakeBatchBestKernel();
+
+    size_t lanes = (size_t)batch->lanes;
+    int32_t **columns[] = {
+        &batch->headX, &batch->headY, &batch->headCell, &batch->tailCell, &batch->foodCell,
+        &batch->direction, &batch->length, &batch->score, &batch->status, &batch->bodyHead,
+        &batch->freeCount, &batch->nextX, &batch->nextY, &batch->nextCell, &batch->nextFlags
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        *columns[i] = calloc(lanes, sizeof(int32_t));
+        ok = ok && *columns[i];
+    }
+    batch->body = calloc(lanes * batch->cellCount, sizeof(int32_t));
+    batch->freeCells = calloc(lanes * batch->cellCount, sizeof(int32_t));
+    batch->freeSlot = calloc(lanes * batch->cellCount, sizeof(int32_t));
+    batch->occupancy = calloc(lanes * batch->words, sizeof(uint32_t));
+    batch->rng = calloc(lanes, sizeof(uint64_t));
+    if (!ok || !batch->body || !batch->freeCells || !batch->freeSlot || !batch->occupancy || !batch->rng) {
+        snakeBatchFree(batch);
+        return false;
+    }
+    // Padding lanes keep zeroed state so the vector kernels can read them safely
+    for (int i = count; i < batch->lanes; i++) {
+        batch->status[i] = SNAKE_DEAD;
+    }
+    for (int i = 0; i < count; i++) {
+        snakeBatchReset(batch, i, seed + (uint64_t)i);
+    }
+    return true;
+}
+
+void snakeBatchFree(SnakeBatch *batch) {
+    int32_t *columns[] = {
+        batch->headX, batch->headY, batch->headCell, batch->tailCell, batch->foodCell,
+        batch->direction, batch->length, batch->score, batch->status, batch->bodyHead,
+        batch->freeCount, batch->nextX, batch->nextY, batch->nextCell, batch->nextFlags,
+        batch->body, batch->freeCells, batch->freeSlot
+    };
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        free(columns[i]);
+    }
+    free(batch->occupancy);
+    free(batch->rng);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void snakeBatchReset(SnakeBatch *batch, int game, uint64_t seed) {
+    memset(batch->occupancy + (size_t)game * batch->words, 0, sizeof(uint32_t) * batch->words);
+    int32_t *freeCells = batch->freeCells + (size_t)game * batch->cellCount;
+    int32_t *freeSlot = batch->freeSlot + (size_t)game * batch->cellCount;
+    for (int i = 0; i < batch->cellCount; i++) {
+        freeCells[i] = i;
+        freeSlot[i] = i;
+    }
+    batch->freeCount[game] = batch->cellCount;
+    batch->bodyHead[game] = 0;
+    batch->length[game] = 0;
+    for (int i = 0; i < INITIAL_LENGTH; i++) {
+        pushHead(batch, game, i, 0, i);
+    }
+    batch->tailCell[game] = 0;
+    batch->direction[game] = RIGHT;
+    batch->score[game] = 0;
+    batch->status[game] = SNAKE_ALIVE;
+    batch->rng[game] = seed;
+    placeFood(batch, game);
+}
+
+// Rejects turning straight back into the neck.
+bool snakeBatchTurn(SnakeBatch *batch, int game, Direction direction) {
+    if ((int32_t)(direction + 2) % 4 == batch->direction[game]) {
+        return false;
+    }
+    batch->direction[game] = direction;
+    return true;
+}
+
+// Reference kernel: computes the next head, whether it lands on food and
+// whether it hits the body (ignoring the tail cell when the tail moves away).
+static void stepKernelScalar(SnakeBatch *batch, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        int x = batch->headX[i];
+        int y = batch->headY[i];
+        switch (batch->direction[i]) {
+            case UP:
+                y = y == 0 ? batch->height - 1 : y - 1;
+                break;
+            case DOWN:
+                y = y == batch->height - 1 ? 0 : y + 1;
+                break;
+            case LEFT:
+                x = x == 0 ? batch->width - 1 : x - 1;
+                break;
+            case RIGHT:
+                x = x == batch->width - 1 ? 0 : x + 1;
+                break;
+        }
+        int cell = y * batch->width + x;
+        bool ate = cell == batch->foodCell[i];
+        bool occupied = (batch->occupancy[(size_t)i * batch->words + cell / 32] >> (cell % 32)) & 1u;
+        bool tailMovesAway = !ate && cell == batch->tailCell[i];
+        batch->nextX[i] = x;
+        batch->nextY[i] = y;
+        batch->nextCell[i] = cell;
+        batch->nextFlags[i] = (ate ? NEXT_ATE : 0) | (occupied && !tailMovesAway ? NEXT_DIED : 0);
+    }
+}
+
+#ifdef SNAKE_BATCH_X86
+__attribute__((target("sse4.1")))
+static void stepKernelSse(SnakeBatch *batch, int begin, int end) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i width = _mm_set1_epi32(batch->width);
+    const __m128i height = _mm_set1_epi32(batch->height);
+    const __m128i lastX = _mm_set1_epi32(batch->width - 1);
+    const __m128i lastY = _mm_set1_epi32(batch->height - 1);
+    for (int i = begin; i < end; i += 4) {
+        __m128i dir = _mm_loadu_si128((const __m128i *)(batch->direction + i));
+        // UP=0 RIGHT=1 DOWN=2 LEFT=3, compares yield -1 so subtracting them gives the step
+        __m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(dir, _mm_set1_epi32(LEFT)), _mm_cmpeq_epi32(dir, _mm_set1_epi32(RIGHT)));
+        __m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(dir, _mm_set1_epi32(UP)), _mm_cmpeq_epi32(dir, _mm_set1_epi32(DOWN)));
+        __m128i x = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(batch->headX + i)), dx);
+        __m128i y = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(batch->headY + i)), dy);
+        x = _mm_blendv_epi8(x, lastX, _mm_cmplt_epi32(x, zero));
+        x = _mm_andnot_si128(_mm_cmpeq_epi32(x, width), x);
+        y = _mm_blendv_epi8(y, lastY, _mm_cmplt_epi32(y, zero));
+        y = _mm_andnot_si128(_mm_cmpeq_epi32(y, height), y);
+        __m128i cell = _mm_add_epi32(_mm_mullo_epi32(y, width), x);
+        __m128i ate = _mm_cmpeq_epi32(cell, _mm_loadu_si128((const __m128i *)(batch->foodCell + i)));
+        __m128i tail = _mm_cmpeq_epi32(cell, _mm_loadu_si128((const __m128i *)(batch->tailCell + i)));
+        _mm_storeu_si128((__m128i *)(batch->nextX + i), x);
+        _mm_storeu_si128((__m128i *)(batch->nextY + i), y);
+        _mm_storeu_si128((__m128i *)(batch->nextCell + i), cell);
+
+        // SSE has no gather or per-lane shift, so the bitboard probe stays scalar
+        int32_t occupied[4];
+        for (int lane = 0; lane < 4; lane++) {
+            int32_t c = batch->nextCell[i + lane];
+            occupied[lane] = -(int32_t)((batch->occupancy[(size_t)(i + lane) * batch->words + c / 32] >> (c % 32)) & 1u);
+        }
+        __m128i hit = _mm_andnot_si128(_mm_andnot_si128(ate, tail), _mm_loadu_si128((const __m128i *)occupied));
+        __m128i flags = _mm_or_si128(_mm_and_si128(ate, _mm_set1_epi32(NEXT_ATE)), _mm_and_si128(hit, _mm_set1_epi32(NEXT_DIED)));
+        _mm_storeu_si128((__m128i *)(batch->nextFlags + i), flags);
+    }
+}
+
+__attribute__((target("avx2")))
+static void stepKernelAvx2(SnakeBatch *batch, int begin, int end) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i width = _mm256_set1_epi32(batch->width);
+    const __m256i height = _mm256_set1_epi32(batch->height);
+    const __m256i lastX = _mm256_set1_epi32(batch->width - 1);
+    const __m256i lastY = _mm256_set1_epi32(batch->height - 1);
+    const __m256i laneWords = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(batch->words));
+    for (int i = begin; i < end; i += 8) {
+        __m256i dir = _mm256_loadu_si256((const __m256i *)(batch->direction + i));
+        __m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, _mm256_set1_epi32(LEFT)), _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(RIGHT)));
+        __m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, _mm256_set1_epi32(UP)), _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(DOWN)));
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(batch->headX + i)), dx);
+        __m256i y = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(batch->headY + i)), dy);
+        x = _mm256_blendv_epi8(x, lastX, _mm256_cmpgt_epi32(zero, x));
+        x = _mm256_andnot_si256(_mm256_cmpeq_epi32(x, width), x);
+        y = _mm256_blendv_epi8(y, lastY, _mm256_cmpgt_epi32(zero, y));
+        y = _mm256_andnot_si256(_mm256_cmpeq_epi32(y, height), y);
+        __m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(y, width), x);
+        __m256i ate = _mm256_cmpeq_epi32(cell, _mm256_loadu_si256((const __m256i *)(batch->foodCell + i)));
+        __m256i tail = _mm256_cmpeq_epi32(cell, _mm256_loadu_si256((const __m256i *)(batch->tailCell + i)));
+
+        // Gather each game's occupancy word and test the head bit. Indices are
+        // relative to this block's first game so they stay small on huge batches.
+        const uint32_t *block = batch->occupancy + (size_t)i * batch->words;
+        __m256i wordIndex = _mm256_add_epi32(laneWords, _mm256_srli_epi32(cell, 5));
+        __m256i word = _mm256_i32gather_epi32((const int *)block, wordIndex, 4);
+        __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_and_si256(cell, _mm256_set1_epi32(31))), one);
+        __m256i hit = _mm256_andnot_si256(_mm256_andnot_si256(ate, tail), _mm256_cmpeq_epi32(bit, one));
+        __m256i flags = _mm256_or_si256(_mm256_and_si256(ate, _mm256_set1_epi32(NEXT_ATE)), _mm256_and_si256(hit, _mm256_set1_epi32(NEXT_DIED)));
+
+        _mm256_storeu_si256((__m256i *)(batch->nextX + i), x);
+        _mm256_storeu_si256((__m256i *)(batch->nextY + i), y);
+        _mm256_storeu_si256((__m256i *)(batch->nextCell + i), cell);
+        _mm256_storeu_si256((__m256i *)(batch->nextFlags + i), flags);
+    }
+}
+#endif
+
+SnakeKernel snakeBatchBestKernel(void) {
+#ifdef SNAKE_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SNAKE_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SNAKE_KERNEL_SSE;
+    }
+#endif
+    return SNAKE_KERNEL_SCALAR;
+}
+
+// Steps every live game by one tick. results, if given, receives the same
+// SnakeStepResult flags snakeStep() would return for each game.
+void snakeBatchStep(SnakeBatch *batch, int *results) {
+    switch (batch->kernel) {
+#ifdef SNAKE_BATCH_X86
+        case SNAKE_KERNEL_AVX2:
+            stepKernelAvx2(batch, 0, batch->lanes);
+            break;
+        case SNAKE_KERNEL_SSE:
+            stepKernelSse(batch, 0, batch->lanes);
+            break;
+#endif
+        default:
+            stepKernelScalar(batch, 0, batch->count);
+            break;
+    }
+
+    // Apply the kernel output; body and free-set bookkeeping is per game
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->status[i] != SNAKE_ALIVE) {
+            if (results) results[i] = SNAKE_STEP_NONE;
+            continue;
+        }
+        int flags = batch->nextFlags[i];
+        int result = SNAKE_STEP_MOVED;
+        if (!(flags & NEXT_ATE)) {
+            popTail(batch, i);
+        }
+        pushHead(batch, i, batch->nextX[i], batch->nextY[i], batch->nextCell[i]);
+        if (flags & NEXT_ATE) {
+            batch->score[i]++;
+            result |= SNAKE_STEP_ATE;
+            if (!placeFood(batch, i)) {
+                batch->status[i] = SNAKE_WON;
+                result |= SNAKE_STEP_WON;
+            }
+        }
+        if (flags & NEXT_DIED) {
+            batch->status[i] = SNAKE_DEAD;
+            result |= SNAKE_STEP_DIED;
+        }
+        if (results) results[i] = result;
+    }
+}
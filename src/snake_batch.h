@@ -0,0 +1,55 @@
+#ifndef SNAKE_BATCH_H
+#define SNAKE_BATCH_H
+
+// Many independent games stepped in lockstep, stored as struct-of-arrays.
+// Every game follows exactly the same rules and RNG stream as a SnakeState
+// seeded with the same value, so the two can be compared tick for tick.
+
+#include "snake_core.h"
+
+#define SNAKE_BATCH_LANES 8
+
+typedef enum {
+    SNAKE_KERNEL_SCALAR,
+    SNAKE_KERNEL_SSE,
+    SNAKE_KERNEL_AVX2
+} SnakeKernel;
+
+typedef struct {
+    int count;           // games in the batch
+    int lanes;           // count rounded up to SNAKE_BATCH_LANES, padding lanes stay dead
+    int width;
+    int height;
+    int cellCount;
+    int words;           // occupancy words per game
+    SnakeKernel kernel;
+    int32_t *headX;
+    int32_t *headY;
+    int32_t *headCell;
+    int32_t *tailCell;
+    int32_t *foodCell;
+    int32_t *direction;
+    int32_t *length;
+    int32_t *score;
+    int32_t *status;
+    int32_t *bodyHead;   // ring slot of the head in each game's body
+    int32_t *body;       // lanes * cellCount cell indices
+    uint32_t *occupancy; // lanes * words
+    int32_t *freeCells;  // lanes * cellCount, same layout as SnakeState
+    int32_t *freeSlot;
+    int32_t *freeCount;
+    uint64_t *rng;
+    int32_t *nextX;      // kernel output for the tick being stepped
+    int32_t *nextY;
+    int32_t *nextCell;
+    int32_t *nextFlags;
+} SnakeBatch;
+
+bool snakeBatchInit(SnakeBatch *batch, int count, int width, int height, uint64_t seed);
+void snakeBatchFree(SnakeBatch *batch);
+void snakeBatchReset(SnakeBatch *batch, int game, uint64_t seed);
+bool snakeBatchTurn(SnakeBatch *batch, int game, Direction direction);
+void snakeBatchStep(SnakeBatch *batch, int *results);
+SnakeKernel snakeBatchBestKernel(void);
+
+#endif // SNAKE_BATCH_H
@@ -0,0 +1,293 @@
+#include "snake_core.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int cellIndex(const SnakeState *state, Point cell) {
+    return cell.y * state->width + cell.x;
+}
+
+static Point cellPoint(const SnakeState *state, int index) {
+    return (Point){index % state->width, index / state->width};
+}
+
+// splitmix64, small and good enough to give every simulated game its own stream
+uint32_t snakeRandomStream(uint64_t *stream, uint32_t bound) {
+    uint64_t z = (*stream += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (uint32_t)(((z >> 32) * bound) >> 32);
+}
+
+uint32_t snakeRandom(SnakeState *state, uint32_t bound) {
+    return snakeRandomStream(&state->rng, bound);
+}
+
+static void setOccupied(SnakeState *state, Point cell, bool occupied) {
+    int index = cellIndex(state, cell);
+    uint32_t bit = 1u << (index % 32);
+    if (((state->occupancy[index / 32] & bit) != 0) == occupied) {
+        return;
+    }
+    if (occupied) {
+        // Swap the last free cell into the vacated slot
+        int slot = state->freeSlot[index];
+        int last = state->freeCells[--state->freeCount];
+        state->freeCells[slot] = last;
+        state->freeSlot[last] = slot;
+        state->occupancy[index / 32] |= bit;
+    } else {
+        state->freeCells[state->freeCount] = index;
+        state->freeSlot[index] = state->freeCount++;
+        state->occupancy[index / 32] &= ~bit;
+    }
+}
+
+bool snakeIsOccupied(const SnakeState *state, Point cell) {
+    return snakeCellOccupied(state, cellIndex(state, cell));
+}
+
+// Segment index (0 is the head) covering a cell, or -1 when the cell is free.
+int snakeSegmentAt(const SnakeState *state, Point cell) {
+    int index = cellIndex(state, cell);
+    if (!snakeCellOccupied(state, index)) {
+        return -1;
+    }
+    int segment = state->bodySlot[index] - state->head;
+    return segment < 0 ? segment + state->cellCount : segment;
+}
+
+static int segmentSlot(const SnakeState *state, int index) {
+    int slot = state->head + index;
+    return slot >= state->cellCount ? slot - state->cellCount : slot;
+}
+
+// Quarter turns that make the head and tail sprites face a direction
+static const uint8_t directionTurns[4] = {
+    [UP] = 3, [RIGHT] = 0, [DOWN] = 1, [LEFT] = 2
+};
+
+// Body or turn sprite for a segment entered moving `in` and left moving `out`.
+// Reversals cannot happen and map to a plain body.
+static const uint8_t bodyCodes[4][4] = {
+    [UP] = {
+        [UP] = SEGMENT_CODE(SEGMENT_BODY, 1, 0),
+        [RIGHT] = SEGMENT_CODE(SEGMENT_TURN, 0, 0),
+        [LEFT] = SEGMENT_CODE(SEGMENT_TURN, 2, 1),
+    },
+    [RIGHT] = {
+        [RIGHT] = SEGMENT_CODE(SEGMENT_BODY, 0, 0),
+        [UP] = SEGMENT_CODE(SEGMENT_TURN, 3, 1),
+        [DOWN] = SEGMENT_CODE(SEGMENT_TURN, 1, 0),
+    },
+    [DOWN] = {
+        [DOWN] = SEGMENT_CODE(SEGMENT_BODY, 1, 0),
+        [RIGHT] = SEGMENT_CODE(SEGMENT_TURN, 0, 1),
+        [LEFT] = SEGMENT_CODE(SEGMENT_TURN, 2, 0),
+    },
+    [LEFT] = {
+        [LEFT] = SEGMENT_CODE(SEGMENT_BODY, 0, 0),
+        [UP] = SEGMENT_CODE(SEGMENT_TURN, 3, 0),
+        [DOWN] = SEGMENT_CODE(SEGMENT_TURN, 1, 1),
+    },
+};
+
+uint8_t snakeBodyCode(Direction in, Direction out) {
+    return bodyCodes[in][out];
+}
+
+// The tail points at the segment in front of it
+static void updateTailCode(SnakeState *state) {
+    if (state->length >= 2) {
+        int tail = segmentSlot(state, state->length - 1);
+        int ahead = segmentSlot(state, state->length - 2);
+        state->codes[tail] = SEGMENT_CODE(SEGMENT_TAIL, directionTurns[state->moves[ahead]], 0);
+    }
+}
+
+// Only the new head and the old head (now the neck) change orientation.
+static void pushHead(SnakeState *state, Point head, Direction move) {
+    int neck = state->head;
+    state->head = state->head == 0 ? state->cellCount - 1 : state->head - 1;
+    state->body[state->head] = head;
+    state->moves[state->head] = (uint8_t)move;
+    state->codes[state->head] = SEGMENT_CODE(SEGMENT_HEAD, directionTurns[move], 0);
+    state->bodySlot[cellIndex(state, head)] = state->head;
+    state->length++;
+    if (state->length >= 3) {
+        state->codes[neck] = bodyCodes[state->moves[neck]][move];
+    } else {
+        updateTailCode(state);
+    }
+    setOccupied(state, head, true);
+}
+
+static void popTail(SnakeState *state) {
+    setOccupied(state, snakeSegment(state, state->length - 1), false);
+    state->length--;
+    updateTailCode(state);
+}
+
+// Returns false when the snake covers the whole board and no food can be placed.
+static bool placeFood(SnakeState *state) {
+    if (state->freeCount == 0) {
+        return false;
+    }
+    state->food = cellPoint(state, state->freeCells[snakeRandom(state, (uint32_t)state->freeCount)]);
+    return true;
+}
+
+bool snakeInit(SnakeState *state, int width, int height, uint64_t seed) {
+    memset(state, 0, sizeof(*state));
+    if (width <= INITIAL_LENGTH || height <= 0) {
+        return false;
+    }
+    state->width = width;
+    state->height = height;
+    state->cellCount = width * height;
+    state->body = malloc(sizeof(Point) * state->cellCount);
+    state->moves = malloc(state->cellCount);
+    state->codes = malloc(state->cellCount);
+    state->occupancy = malloc(sizeof(uint32_t) * ((state->cellCount + 31) / 32));
+    state->freeCells = malloc(sizeof(int) * state->cellCount);
+    state->freeSlot = malloc(sizeof(int) * state->cellCount);
+    state->bodySlot = malloc(sizeof(int) * state->cellCount);
+    if (!state->body || !state->moves || !state->codes || !state->occupancy || !state->freeCells || !state->freeSlot ||
+        !state->bodySlot) {
+        snakeFree(state);
+        return false;
+    }
+    snakeReset(state, seed);
+    return true;
+}
+
+void snakeFree(SnakeState *state) {
+    free(state->body);
+    free(state->moves);
+    free(state->codes);
+    free(state->occupancy);
+    free(state->freeCells);
+    free(state->freeSlot);
+    free(state->bodySlot);
+    state->body = NULL;
+    state->moves = NULL;
+    state->codes = NULL;
+    state->occupancy = NULL;
+    state->freeCells = NULL;
+    state->freeSlot = NULL;
+    state->bodySlot = NULL;
+}
+
+void snakeReset(SnakeState *state, uint64_t seed) {
+    memset(state->occupancy, 0, sizeof(uint32_t) * ((state->cellCount + 31) / 32));
+    for (int i = 0; i < state->cellCount; i++) {
+        state->freeCells[i] = i;
+        state->freeSlot[i] = i;
+    }
+    state->freeCount = state->cellCount;
+    state->head = 0;
+    state->length = 0;
+    for (int i = 0; i < INITIAL_LENGTH; i++) {
+        pushHead(state, (Point){i, 0}, RIGHT);
+    }
+    state->direction = RIGHT;
+    state->score = 0;
+    state->status = SNAKE_ALIVE;
+    state->rng = seed;
+    placeFood(state);
+}
+
+// The adjacent cell in the given direction, wrapping around the board edges.
+Point snakeNeighbour(Point cell, Direction direction, int width, int height) {
+    switch (direction) {
+        case UP:
+            cell.y = cell.y == 0 ? height - 1 : cell.y - 1;
+            break;
+        case DOWN:
+            cell.y = cell.y == height - 1 ? 0 : cell.y + 1;
+            break;
+        case LEFT:
+            cell.x = cell.x == 0 ? width - 1 : cell.x - 1;
+            break;
+        case RIGHT:
+            cell.x = cell.x == width - 1 ? 0 : cell.x + 1;
+            break;
+    }
+    return cell;
+}
+
+// Rejects turning straight back into the neck.
+bool snakeTurn(SnakeState *state, Direction direction) {
+    if ((direction + 2) % 4 == state->direction) {
+        return false;
+    }
+    state->direction = direction;
+    return true;
+}
+
+int snakeStep(SnakeState *state) {
+    if (state->status != SNAKE_ALIVE) {
+        return SNAKE_STEP_NONE;
+    }
+    Point newHead = snakeNeighbour(snakeSegment(state, 0), state->direction, state->width, state->height);
+    int result = SNAKE_STEP_MOVED;
+    bool ateFood = newHead.x == state->food.x && newHead.y == state->food.y;
+    // Growing keeps the tail in place, otherwise the snake slides by one cell.
+    // The tail is popped first so moving into the cell it just left is legal.
+    if (!ateFood) {
+        popTail(state);
+    }
+    bool collided = snakeIsOccupied(state, newHead);
+    pushHead(state, newHead, state->direction);
+    if (ateFood) {
+        state->score++;
+        result |= SNAKE_STEP_ATE;
+        if (!placeFood(state)) {
+            state->status = SNAKE_WON;
+            result |= SNAKE_STEP_WON;
+        }
+    }
+    if (collided) {
+        state->status = SNAKE_DEAD;
+        result |= SNAKE_STEP_DIED;
+    }
+    return result;
+}
+
+Point snakeSegment(const SnakeState *state, int index) {
+    return state->body[segmentSlot(state, index)];
+}
+
+uint8_t snakeSegmentCode(const SnakeState *state, int index) {
+    return state->codes[segmentSlot(state, index)];
+}
+
+Direction snakeSegmentMove(const SnakeState *state, int index) {
+    return (Direction)state->moves[segmentSlot(state, index)];
+}
+
+SnakeIterator snakeBegin(const SnakeState *state) {
+    return (SnakeIterator){state->head, state->length};
+}
+
+bool snakeNext(const SnakeState *state, SnakeIterator *it, Point *segment) {
+    if (it->remaining <= 0) {
+        return false;
+    }
+    *segment = state->body[it->slot];
+    it->remaining--;
+    if (++it->slot == state->cellCount) it->slot = 0;
+    return true;
+}
+
+bool snakeNextCoded(const SnakeState *state, SnakeIterator *it, Point *segment, uint8_t *code) {
+    if (it->remaining > 0) {
+        *code = state->codes[it->slot];
+    }
+    return snakeNext(state, it, segment);
+}
+
+// Returns the segment the next snakeNext() call would yield.
+Point snakePeek(const SnakeState *state, const SnakeIterator *it) {
+    return state->body[it->slot];
+}
@@ -0,0 +1,109 @@
+#ifndef SNAKE_CORE_H
+#define SNAKE_CORE_H
+
+// Game rules only: no SDL, no rendering, no audio. Coordinates are in cells.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define INITIAL_LENGTH 3
+
+typedef struct {
+    int x;
+    int y;
+} Point;
+
+typedef enum {
+    UP,
+    RIGHT,
+    DOWN,
+    LEFT
+} Direction;
+
+typedef enum {
+    SNAKE_ALIVE,
+    SNAKE_DEAD,
+    SNAKE_WON
+} SnakeStatus;
+
+// Flags returned by snakeStep()
+typedef enum {
+    SNAKE_STEP_NONE = 0,
+    SNAKE_STEP_MOVED = 1 << 0,
+    SNAKE_STEP_ATE = 1 << 1,
+    SNAKE_STEP_DIED = 1 << 2,
+    SNAKE_STEP_WON = 1 << 3
+} SnakeStepResult;
+
+typedef enum {
+    SEGMENT_HEAD,
+    SEGMENT_BODY,
+    SEGMENT_TURN,
+    SEGMENT_TAIL
+} SegmentKind;
+
+// Sprite and orientation of one segment packed in a byte: kind in bits 3-4,
+// vertical flip in bit 2, clockwise quarter turns in bits 0-1.
+#define SEGMENT_CODE(kind, turns, flip) ((uint8_t)(((kind) << 3) | ((flip) << 2) | (turns)))
+#define SEGMENT_KIND(code) ((SegmentKind)((code) >> 3))
+#define SEGMENT_FLIPPED(code) (((code) >> 2) & 1)
+#define SEGMENT_TURNS(code) ((code) & 3)
+
+// Walks the snake from head to tail without exposing the ring buffer layout.
+typedef struct {
+    int slot;
+    int remaining;
+} SnakeIterator;
+
+typedef struct {
+    int width;
+    int height;
+    int cellCount;
+    Point *body;         // ring buffer of cellCount entries, head is the slot of the head
+    uint8_t *moves;      // per slot, the direction moved to enter that segment's cell
+    uint8_t *codes;      // per slot, the segment's SEGMENT_CODE, kept up to date each step
+    int head;
+    int length;
+    uint32_t *occupancy; // one bit per cell covered by the snake
+    int *freeCells;      // dense set of cells not covered by the snake
+    int *freeSlot;       // position of each free cell in freeCells
+    int *bodySlot;       // ring slot of the segment on each occupied cell
+    int freeCount;
+    Point food;
+    Direction direction;
+    int score;
+    SnakeStatus status;
+    uint64_t rng;
+} SnakeState;
+
+bool snakeInit(SnakeState *state, int width, int height, uint64_t seed);
+void snakeFree(SnakeState *state);
+void snakeReset(SnakeState *state, uint64_t seed);
+int snakeStep(SnakeState *state);
+bool snakeTurn(SnakeState *state, Direction direction);
+
+Point snakeSegment(const SnakeState *state, int index);
+uint8_t snakeSegmentCode(const SnakeState *state, int index);
+Direction snakeSegmentMove(const SnakeState *state, int index);
+uint8_t snakeBodyCode(Direction in, Direction out);
+SnakeIterator snakeBegin(const SnakeState *state);
+bool snakeNext(const SnakeState *state, SnakeIterator *it, Point *segment);
+bool snakeNextCoded(const SnakeState *state, SnakeIterator *it, Point *segment, uint8_t *code);
+Point snakePeek(const SnakeState *state, const SnakeIterator *it);
+bool snakeIsOccupied(const SnakeState *state, Point cell);
+int snakeSegmentAt(const SnakeState *state, Point cell);
+Point snakeNeighbour(Point cell, Direction direction, int width, int height);
+uint32_t snakeRandom(SnakeState *state, uint32_t bound);
+uint32_t snakeRandomStream(uint64_t *stream, uint32_t bound);
+
+// Occupancy by cell index (y * width + x), inline for per-cell render loops.
+static inline bool snakeCellOccupied(const SnakeState *state, int index) {
+    return (state->occupancy[index / 32] >> (index % 32)) & 1u;
+}
+
+// One bit for each of the 32 cells from index - index % 32, so callers can skip empty runs.
+static inline uint32_t snakeOccupancyWord(const SnakeState *state, int index) {
+    return state->occupancy[index / 32];
+}
+
+#endif // SNAKE_CORE_H
@@ -0,0 +1,272 @@
+#include "snake_pool.h"
+#include "snake_batch.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define DEFAULT_CHUNK_SIZE 64
+
+int snakeDefaultThreadCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int wrappedDistance(int from, int to, int size) {
+    int distance = abs(to - from);
+    return distance < size - distance ? distance : size - distance;
+}
+
+// Heads for the food along the shortest wrapped path, never into the body.
+Direction snakeGreedyPolicy(const SnakeView *view, uint64_t *rng, void *data) {
+    (void)data;
+    Direction best = view->direction;
+    int bestDistance = INT_MAX;
+    uint32_t ties = 0;
+    for (int d = UP; d <= LEFT; d++) {
+        if ((d + 2) % 4 == (int)view->direction) {
+            continue;
+        }
+        Point next = snakeNeighbour(view->head, d, view->width, view->height);
+        int cell = next.y * view->width + next.x;
+        if ((view->occupancy[cell / 32] >> (cell % 32)) & 1u) {
+            continue;
+        }
+        int distance = wrappedDistance(next.x, view->food.x, view->width) +
+                       wrappedDistance(next.y, view->food.y, view->height);
+        if (distance < bestDistance) {
+            best = d;
+            bestDistance = distance;
+            ties = 1;
+        } else if (distance == bestDistance && snakeRandomStream(rng, ++ties) == 0) {
+            best = d;
+        }
+    }
+    return best;
+}
+
+// Policy stream for one game, independent of the stream that places food.
+static uint64_t policySeed(const SnakeWorkload *work, int game) {
+    return (work->seed ^ 0xD1B54A32D192ED03ull) + (uint64_t)game * 0x9E3779B97F4A7C15ull;
+}
+
+static void recordGame(SnakeWorker *worker, const SnakeWorkload *work, int game, int score, bool won) {
+    worker->games++;
+    worker->totalScore += score;
+    if (won) worker->wins++;
+    if (work->scores) work->scores[game] = score;
+}
+
+static void playGame(SnakeWorker *worker, const SnakeWorkload *work, SnakeState *state, int game) {
+    SnakePolicy policy = work->policy ? work->policy : snakeGreedyPolicy;
+    uint64_t policyRng = policySeed(work, game);
+    snakeReset(state, work->seed + (uint64_t)game);
+    int ticks = 0;
+    while (state->status == SNAKE_ALIVE && (work->maxTicks == 0 || ticks < work->maxTicks)) {
+        SnakeView view = {snakeSegment(state, 0), state->food, state->direction,
+                          state->width, state->height, state->occupancy};
+        snakeTurn(state, policy(&view, &policyRng, work->policyData));
+        snakeStep(state);
+        ticks++;
+    }
+    worker->ticks += ticks;
+    recordGame(worker, work, game, state->score, state->status == SNAKE_WON);
+}
+
+static void playChunkBatched(SnakeWorker *worker, const SnakeWorkload *work, SnakeBatch *batch,
+                             uint64_t *policyRng, int first, int count) {
+    SnakePolicy policy = work->policy ? work->policy : snakeGreedyPolicy;
+    for (int lane = 0; lane < batch->count; lane++) {
+        if (lane < count) {
+            snakeBatchReset(batch, lane, work->seed + (uint64_t)(first + lane));
+            policyRng[lane] = policySeed(work, first + lane);
+        } else {
+            batch->status[lane] = SNAKE_DEAD;
+        }
+    }
+    for (int tick = 0; work->maxTicks == 0 || tick < work->maxTicks; tick++) {
+        int alive = 0;
+        for (int lane = 0; lane < count; lane++) {
+            if (batch->status[lane] != SNAKE_ALIVE) {
+                continue;
+            }
+            int food = batch->foodCell[lane];
+            SnakeView view = {{batch->headX[lane], batch->headY[lane]},
+                              {food % batch->width, food / batch->width},
+                              batch->direction[lane], batch->width, batch->height,
+                              batch->occupancy + (size_t)lane * batch->words};
+            snakeBatchTurn(batch, lane, policy(&view, &policyRng[lane], work->policyData));
+            alive++;
+        }
+        if (alive == 0) {
+            break;
+        }
+        snakeBatchStep(batch, NULL);
+        worker->ticks += alive;
+    }
+    for (int lane = 0; lane < count; lane++) {
+        recordGame(worker, work, first + lane, batch->score[lane], batch->status[lane] == SNAKE_WON);
+    }
+}
+
+// Pops from the bottom of our own range, otherwise steals from the top of another worker's.
+static bool takeChunk(SnakeWorker *worker, int *chunk) {
+    SnakePool *pool = worker->pool;
+    pthread_mutex_lock(&worker->lock);
+    bool found = worker->top < worker->bottom;
+    if (found) *chunk = --worker->bottom;
+    pthread_mutex_unlock(&worker->lock);
+    if (found) {
+        return true;
+    }
+    int start = (int)snakeRandomStream(&worker->victimRng, (uint32_t)pool->threadCount);
+    for (int i = 0; i < pool->threadCount; i++) {
+        SnakeWorker *victim = &pool->workers[(start + i) % pool->threadCount];
+        if (victim == worker) {
+            continue;
+        }
+        pthread_mutex_lock(&victim->lock);
+        found = victim->top < victim->bottom;
+        if (found) *chunk = victim->top++;
+        pthread_mutex_unlock(&victim->lock);
+        if (found) {
+            worker->steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool runWorker(SnakeWorker *worker, const SnakeWorkload *work, int chunkSize) {
+    SnakeState state;
+    SnakeBatch batch;
+    uint64_t *policyRng = NULL;
+    if (work->batched) {
+        policyRng = malloc(sizeof(uint64_t) * chunkSize);
+        if (!policyRng || !snakeBatchInit(&batch, chunkSize, work->width, work->height, work->seed)) {
+            free(policyRng);
+            return false;
+        }
+    } else if (!snakeInit(&state, work->width, work->height, work->seed)) {
+        return false;
+    }
+
+    int chunk;
+    while (takeChunk(worker, &chunk)) {
+        int first = chunk * chunkSize;
+        int count = work->games - first < chunkSize ? work->games - first : chunkSize;
+        if (work->batched) {
+            playChunkBatched(worker, work, &batch, policyRng, first, count);
+        } else {
+            for (int game = first; game < first + count; game++) {
+                playGame(worker, work, &state, game);
+            }
+        }
+    }
+
+    if (work->batched) {
+        snakeBatchFree(&batch);
+        free(policyRng);
+    } else {
+        snakeFree(&state);
+    }
+    return true;
+}
+
+// Worker job of the group: drains this worker's chunks, then steals.
+static void runPoolWorker(void *context, int index) {
+    SnakePool *pool = context;
+    const SnakeWorkload *work = pool->work;
+    int chunkSize = work->chunkSize > 0 ? work->chunkSize : DEFAULT_CHUNK_SIZE;
+    pool->workers[index].failed = !runWorker(&pool->workers[index], work, chunkSize);
+}
+
+// threads <= 0 starts one worker per core.
+SnakePool *snakePoolCreate(int threads) {
+    SnakePool *pool = calloc(1, sizeof(SnakePool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->threadCount = threads > 0 ? threads : snakeDefaultThreadCount();
+    pool->workers = calloc(pool->threadCount, sizeof(SnakeWorker));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i < pool->threadCount; i++) {
+        pthread_mutex_init(&pool->workers[i].lock, NULL);
+        pool->workers[i].pool = pool;
+    }
+    if (!workerGroupInit(&pool->group, pool->threadCount, runPoolWorker, pool)) {
+        snakePoolDestroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void snakePoolDestroy(SnakePool *pool) {
+    workerGroupFree(&pool->group);
+    for (int i = 0; i < pool->threadCount; i++) {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+    }
+    free(pool->workers);
+    free(pool);
+}
+
+// Plays every game of the workload and blocks until all workers are done.
+bool snakePoolRun(SnakePool *pool, const SnakeWorkload *work, SnakePoolStats *stats) {
+    if (work->games <= 0) {
+        return false;
+    }
+    int chunkSize = work->chunkSize > 0 ? work->chunkSize : DEFAULT_CHUNK_SIZE;
+    int chunks = (work->games + chunkSize - 1) / chunkSize;
+    for (int i = 0; i < pool->threadCount; i++) {
+        SnakeWorker *worker = &pool->workers[i];
+        worker->top = (int)((long long)chunks * i / pool->threadCount);
+        worker->bottom = (int)((long long)chunks * (i + 1) / pool->threadCount);
+        worker->games = worker->ticks = worker->wins = worker->totalScore = worker->steals = 0;
+        worker->victimRng = (uint64_t)i + 1;
+        worker->failed = false;
+    }
+
+    double start = nowSeconds();
+    pool->work = work;
+    workerGroupRun(&pool->group);
+    double elapsed = nowSeconds() - start;
+
+    bool ok = true;
+    for (int i = 0; i < pool->threadCount; i++) {
+        if (pool->workers[i].failed) ok = false;
+    }
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        for (int i = 0; i < pool->threadCount; i++) {
+            stats->games += pool->workers[i].games;
+            stats->ticks += pool->workers[i].ticks;
+            stats->wins += pool->workers[i].wins;
+            stats->totalScore += pool->workers[i].totalScore;
+            stats->steals += pool->workers[i].steals;
+        }
+        stats->seconds = elapsed;
+        stats->gamesPerSecond = elapsed > 0 ? stats->games / elapsed : 0;
+        stats->ticksPerSecond = elapsed > 0 ? stats->ticks / elapsed : 0;
+    }
+    return ok;
+}
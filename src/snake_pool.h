@@ -0,0 +1,80 @@
+#ifndef SNAKE_POOL_H
+#define SNAKE_POOL_H
+
+// Work-stealing thread pool that plays many independent games headless.
+// Games are split into chunks; each worker drains its own chunk range and
+// steals from the others when it runs dry. Every game draws from its own
+// RNG streams keyed on (seed, game index), so results do not depend on the
+// thread count or on which worker happened to run a chunk.
+
+#include <pthread.h>
+#include "snake_core.h"
+#include "worker_group.h"
+
+// What a policy gets to see of a game before choosing the next direction.
+typedef struct {
+    Point head;
+    Point food;
+    Direction direction;
+    int width;
+    int height;
+    const uint32_t *occupancy;
+} SnakeView;
+
+typedef Direction (*SnakePolicy)(const SnakeView *view, uint64_t *rng, void *data);
+
+typedef struct {
+    int games;
+    int width;
+    int height;
+    uint64_t seed;
+    int maxTicks;        // per game, 0 plays until the game is lost or won
+    int chunkSize;       // games per task, 0 picks a default
+    bool batched;        // step each chunk in lockstep through a SnakeBatch
+    SnakePolicy policy;  // NULL uses snakeGreedyPolicy
+    void *policyData;
+    int *scores;         // optional, receives the final score of every game
+} SnakeWorkload;
+
+typedef struct {
+    long long games;
+    long long ticks;
+    long long wins;
+    long long totalScore;
+    long long steals;
+    double seconds;
+    double gamesPerSecond;
+    double ticksPerSecond;
+} SnakePoolStats;
+
+typedef struct SnakePool SnakePool;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int top;             // thieves take chunks from here
+    int bottom;          // the owner takes chunks from here
+    long long games;
+    long long ticks;
+    long long wins;
+    long long totalScore;
+    long long steals;
+    uint64_t victimRng;
+    bool failed;
+    SnakePool *pool;
+    char padding[64];    // keep workers off each other's cache lines
+} SnakeWorker;
+
+struct SnakePool {
+    int threadCount;     // the caller of snakePoolRun() works as worker 0
+    SnakeWorker *workers;
+    WorkerGroup group;
+    const SnakeWorkload *work;
+};
+
+SnakePool *snakePoolCreate(int threads);
+void snakePoolDestroy(SnakePool *pool);
+bool snakePoolRun(SnakePool *pool, const SnakeWorkload *work, SnakePoolStats *stats);
+int snakeDefaultThreadCount(void);
+Direction snakeGreedyPolicy(const SnakeView *view, uint64_t *rng, void *data);
+
+#endif // SNAKE_POOL_H
@@ -0,0 +1,49 @@
+#include "sound_bank.h"
+#include <stdio.h>
+#include <string.h>
+
+// Takes ownership of chunks decoded with Mix_LoadWAV(), even when it fails,
+// so destroySoundBank() always frees them.
+bool createSoundBank(SoundBank *bank, Mix_Chunk *chunks[SOUND_COUNT], int channels) {
+    memset(bank, 0, sizeof(*bank));
+    memcpy(bank->chunks, chunks, sizeof(bank->chunks));
+    if (Mix_AllocateChannels(channels) < channels) {
+        printf("Unable to allocate %d mixer channels! SDL_mixer Error: %s\n", channels, Mix_GetError());
+        return false;
+    }
+    // Reserved channels are skipped by Mix_PlayChannel(-1), so nothing else steals ours
+    int reserved = Mix_ReserveChannels(channels);
+    if (reserved != channels) {
+        printf("Only %d of %d mixer channels could be reserved! SDL_mixer Error: %s\n", reserved, channels, Mix_GetError());
+        Mix_ReserveChannels(0);
+        return false;
+    }
+    bank->channels = channels;
+    if (channels > 0) {
+        Mix_GroupChannels(0, channels - 1, SOUND_GROUP);
+    }
+    return true;
+}
+
+void destroySoundBank(SoundBank *bank) {
+    // A chunk must not be freed while a channel still plays it
+    if (bank->channels > 0) {
+        Mix_HaltGroup(SOUND_GROUP);
+    }
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        Mix_FreeChunk(bank->chunks[i]);
+    }
+    memset(bank, 0, sizeof(*bank));
+}
+
+// Takes a free channel of the bank, or the one that has played the longest.
+void playSound(SoundBank *bank, SoundId sound) {
+    if (bank->channels == 0) {
+        return;
+    }
+    int channel = Mix_GroupAvailable(SOUND_GROUP);
+    if (channel == -1) {
+        channel = Mix_GroupOldest(SOUND_GROUP);
+    }
+    Mix_PlayChannel(channel, bank->chunks[sound], 0);
+}
@@ -0,0 +1,27 @@
+#ifndef SOUND_BANK_H
+#define SOUND_BANK_H
+
+#include <SDL2/SDL_mixer.h>
+#include <stdbool.h>
+
+typedef enum {
+    SOUND_APPLE_EAT,
+    SOUND_COUNT
+} SoundId;
+
+#define SOUND_CHANNELS 8
+#define SOUND_GROUP 1
+
+// Every effect decoded once at startup and played on a fixed set of
+// reserved mixer channels. When all of them are busy the oldest voice is
+// cut off, so playing a sound never waits, loads or allocates.
+typedef struct {
+    Mix_Chunk *chunks[SOUND_COUNT];
+    int channels;               // mixer channels [0, channels) belong to the bank
+} SoundBank;
+
+bool createSoundBank(SoundBank *bank, Mix_Chunk *chunks[SOUND_COUNT], int channels);
+void destroySoundBank(SoundBank *bank);
+void playSound(SoundBank *bank, SoundId sound);
+
+#endif // SOUND_BANK_H
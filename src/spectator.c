@@ -0,0 +1,207 @@
+#include "spectator.h"
+#include "snake_pool.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TILE_GAP 2
+
+static const SpriteId segmentSprites[4] = {
+    [SEGMENT_HEAD] = SPRITE_HEAD,
+    [SEGMENT_BODY] = SPRITE_BODY,
+    [SEGMENT_TURN] = SPRITE_TURN,
+    [SEGMENT_TAIL] = SPRITE_TAIL,
+};
+
+// Every board draws its body plus the food while the game is running
+static int boardQuads(const SnakeState *game) {
+    return game->length + (game->status == SNAKE_ALIVE ? 1 : 0);
+}
+
+static void restartBoard(Spectator *spectator, int board) {
+    uint64_t seed = spectator->seed + (uint64_t)board * 0x9E3779B97F4A7C15ull + (uint64_t)spectator->rounds[board]++;
+    snakeReset(&spectator->games[board], seed);
+    spectator->policyRng[board] = seed ^ 0xD1B54A32D192ED03ull;
+}
+
+static void stepBoards(Spectator *spectator, int first, int count) {
+    for (int board = first; board < first + count; board++) {
+        SnakeState *game = &spectator->games[board];
+        for (int tick = 0; tick < spectator->ticks; tick++) {
+            SnakeView view = {snakeSegment(game, 0), game->food, game->direction,
+                              game->width, game->height, game->occupancy};
+            snakeTurn(game, snakeGreedyPolicy(&view, &spectator->policyRng[board], NULL));
+            if (snakeStep(game) & (SNAKE_STEP_DIED | SNAKE_STEP_WON)) {
+                restartBoard(spectator, board);
+            }
+        }
+        spectator->spriteStart[board] = boardQuads(game);
+    }
+}
+
+static void generateBoards(Spectator *spectator, int first, int count) {
+    float cell = spectator->cellSize * spectator->scale;
+    for (int board = first; board < first + count; board++) {
+        const SnakeState *game = &spectator->games[board];
+        float left = (board % spectator->columns) * spectator->tileWidth;
+        float top = (board / spectator->columns) * spectator->tileHeight;
+        SDL_Vertex *backdrop = &spectator->backgrounds[board * 4];
+        for (int c = 0; c < 4; c++) {
+            float u = (float)(c & 1);
+            float v = (float)(c >> 1);
+            backdrop[c] = (SDL_Vertex){{left + u * game->width * cell, top + v * game->height * cell},
+                                       {255, 255, 255, 255}, {u, v}};
+        }
+
+        SDL_Vertex *vertex = &spectator->vertices[(size_t)spectator->spriteStart[board] * 4];
+        SnakeIterator it = snakeBegin(game);
+        Point segment;
+        uint8_t code;
+        while (snakeNextCoded(game, &it, &segment, &code)) {
+            SDL_FRect rect = {left + segment.x * cell, top + segment.y * cell, cell, cell};
+            // The low bits of a segment code are exactly its CELL_ORIENTATION
+            writeSpriteQuad(spectator->atlas, vertex, segmentSprites[SEGMENT_KIND(code)], code & 7, &rect);
+            vertex += 4;
+        }
+        if (game->status == SNAKE_ALIVE) {
+            SDL_FRect rect = {left + game->food.x * cell, top + game->food.y * cell, cell, cell};
+            writeSpriteQuad(spectator->atlas, vertex, SPRITE_APPLE, 0, &rect);
+        }
+    }
+}
+
+// Worker job of the group, over this worker's share of the boards.
+static void runPhase(void *context, int worker) {
+    Spectator *spectator = context;
+    int first = spectator->boards * worker / spectator->threadCount;
+    int count = spectator->boards * (worker + 1) / spectator->threadCount - first;
+    if (spectator->phase == SPECTATOR_STEP) {
+        stepBoards(spectator, first, count);
+    } else {
+        generateBoards(spectator, first, count);
+    }
+}
+
+// Runs one phase over all boards and returns once every worker is done.
+static void dispatch(Spectator *spectator, SpectatorPhase phase) {
+    spectator->phase = phase;
+    workerGroupRun(&spectator->workers);
+}
+
+// threads <= 0 uses one thread per core, never more than one per board.
+bool spectatorInit(Spectator *spectator, int boards, int width, int height, int cellSize,
+                   const SpriteAtlas *atlas, uint64_t seed, int threads) {
+    memset(spectator, 0, sizeof(*spectator));
+    spectator->boards = boards;
+    spectator->width = width;
+    spectator->height = height;
+    spectator->cellSize = cellSize;
+    spectator->atlas = atlas;
+    spectator->seed = seed;
+    if (width <= 0 || height <= 0 || (long long)boards * ((long long)width * height + 1) > INT_MAX / 6) {
+        printf("Unable to allocate %d spectator boards of %dx%d!\n", boards, width, height);
+        return false;
+    }
+    spectator->capacity = boards * (width * height + 1);
+    spectator->games = calloc(boards, sizeof(SnakeState));
+    spectator->policyRng = calloc(boards, sizeof(uint64_t));
+    spectator->rounds = calloc(boards, sizeof(int));
+    spectator->spriteStart = calloc(boards, sizeof(int));
+    spectator->vertices = malloc(sizeof(SDL_Vertex) * 4 * (size_t)spectator->capacity);
+    spectator->backgrounds = malloc(sizeof(SDL_Vertex) * 4 * (size_t)boards);
+    spectator->indices = malloc(sizeof(int) * 6 * (size_t)spectator->capacity);
+    if (!spectator->games || !spectator->policyRng || !spectator->rounds || !spectator->spriteStart ||
+        !spectator->vertices || !spectator->backgrounds || !spectator->indices) {
+        printf("Unable to allocate %d spectator boards!\n", boards);
+        spectatorFree(spectator);
+        return false;
+    }
+    fillQuadIndices(spectator->indices, spectator->capacity);
+    for (int board = 0; board < boards; board++) {
+        if (!snakeInit(&spectator->games[board], width, height, seed)) {
+            printf("Unable to allocate %d spectator boards!\n", boards);
+            spectatorFree(spectator);
+            return false;
+        }
+        restartBoard(spectator, board);
+    }
+
+    threads = threads > 0 ? threads : snakeDefaultThreadCount();
+    spectator->threadCount = threads < boards ? threads : boards;
+    if (!workerGroupInit(&spectator->workers, spectator->threadCount, runPhase, spectator)) {
+        spectatorFree(spectator);
+        return false;
+    }
+    spectatorStep(spectator, 0);
+    return true;
+}
+
+void spectatorFree(Spectator *spectator) {
+    workerGroupFree(&spectator->workers);
+    if (spectator->games) {
+        for (int board = 0; board < spectator->boards; board++) {
+            snakeFree(&spectator->games[board]);
+        }
+    }
+    free(spectator->games);
+    free(spectator->policyRng);
+    free(spectator->rounds);
+    free(spectator->spriteStart);
+    free(spectator->vertices);
+    free(spectator->backgrounds);
+    free(spectator->indices);
+    memset(spectator, 0, sizeof(*spectator));
+}
+
+// Advances every board by ticks and lays their sprites out for the next render.
+void spectatorStep(Spectator *spectator, int ticks) {
+    spectator->ticks = ticks;
+    dispatch(spectator, SPECTATOR_STEP);
+    int start = 0;
+    for (int board = 0; board < spectator->boards; board++) {
+        int quads = spectator->spriteStart[board];
+        spectator->spriteStart[board] = start;
+        start += quads;
+    }
+    spectator->quads = start;
+}
+
+// Fits the most boards of the right aspect into the output, one tile each.
+static void layoutTiles(Spectator *spectator, int outputWidth, int outputHeight) {
+    float boardWidth = (float)spectator->width * spectator->cellSize;
+    float boardHeight = (float)spectator->height * spectator->cellSize;
+    spectator->scale = 0.0f;
+    for (int columns = 1; columns <= spectator->boards; columns++) {
+        int rows = (spectator->boards + columns - 1) / columns;
+        float scaleX = ((float)outputWidth / columns - TILE_GAP) / boardWidth;
+        float scaleY = ((float)outputHeight / rows - TILE_GAP) / boardHeight;
+        float scale = scaleX < scaleY ? scaleX : scaleY;
+        if (scale > spectator->scale) {
+            spectator->scale = scale;
+            spectator->columns = columns;
+            spectator->rows = rows;
+        }
+    }
+    spectator->tileWidth = boardWidth * spectator->scale + TILE_GAP;
+    spectator->tileHeight = boardHeight * spectator->scale + TILE_GAP;
+    spectator->outputWidth = outputWidth;
+    spectator->outputHeight = outputHeight;
+}
+
+// Two draw calls per frame however many boards there are: the tile
+// backgrounds, then every board's sprites from the shared atlas.
+void spectatorRender(Spectator *spectator, SDL_Renderer *renderer, SDL_Texture *background) {
+    int outputWidth, outputHeight;
+    SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+    if (outputWidth != spectator->outputWidth || outputHeight != spectator->outputHeight) {
+        layoutTiles(spectator, outputWidth, outputHeight);
+    }
+    dispatch(spectator, SPECTATOR_GENERATE);
+
+    SDL_RenderClear(renderer);
+    SDL_RenderGeometry(renderer, background, spectator->backgrounds, spectator->boards * 4,
+                       spectator->indices, spectator->boards * 6);
+    SDL_RenderGeometry(renderer, spectator->atlas->texture, spectator->vertices, spectator->quads * 4,
+                       spectator->indices, spectator->quads * 6);
+}
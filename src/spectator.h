@@ -0,0 +1,53 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+// Many bot-driven boards tiled into one window. Worker threads step the
+// games and write every board's sprite quads straight into one shared
+// vertex buffer, which then goes out as a single SDL_RenderGeometry call.
+
+#include <SDL2/SDL.h>
+#include "snake_core.h"
+#include "sprite_atlas.h"
+#include "worker_group.h"
+
+typedef enum {
+    SPECTATOR_STEP,      // advance every board and count its sprites
+    SPECTATOR_GENERATE   // write quads at the offsets counted in the step phase
+} SpectatorPhase;
+
+typedef struct {
+    int boards;
+    int width;           // board size in cells
+    int height;
+    int cellSize;        // board size in pixels before tile scaling
+    uint64_t seed;
+    SnakeState *games;
+    uint64_t *policyRng;
+    int *rounds;         // games played on each board, feeds the next seed
+    int *spriteStart;    // first quad of each board, prefix sum of the step phase counts
+    const SpriteAtlas *atlas;
+    SDL_Vertex *vertices;    // sprite quads of every board
+    SDL_Vertex *backgrounds; // one background quad per board
+    int *indices;
+    int capacity;        // quads the buffers hold
+    int quads;           // sprite quads written this frame
+    int columns;         // tile layout, recomputed when the output size changes
+    int rows;
+    int outputWidth;
+    int outputHeight;
+    float scale;
+    float tileWidth;
+    float tileHeight;
+    int threadCount;     // the caller works as worker 0
+    WorkerGroup workers; // worker i owns an even share of the boards
+    SpectatorPhase phase;
+    int ticks;           // ticks to step in the current SPECTATOR_STEP phase
+} Spectator;
+
+bool spectatorInit(Spectator *spectator, int boards, int width, int height, int cellSize,
+                   const SpriteAtlas *atlas, uint64_t seed, int threads);
+void spectatorFree(Spectator *spectator);
+void spectatorStep(Spectator *spectator, int ticks);
+void spectatorRender(Spectator *spectator, SDL_Renderer *renderer, SDL_Texture *background);
+
+#endif // SPECTATOR_H
@@ -0,0 +1,226 @@
+#include "sprite_atlas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Resamples an ARGB8888 surface with bilinear filtering. Large reductions
+// are done in halving steps so every source pixel still contributes.
+SDL_Surface *resampleSurface(SDL_Surface *source, int width, int height) {
+    SDL_Surface *current = source;
+    while (current->w / 2 >= width && current->h / 2 >= height) {
+        SDL_Surface *half = SDL_CreateRGBSurfaceWithFormat(0, current->w / 2, current->h / 2, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!half || SDL_SoftStretchLinear(current, NULL, half, NULL) != 0) {
+            SDL_FreeSurface(half);
+            break;
+        }
+        if (current != source) SDL_FreeSurface(current);
+        current = half;
+    }
+    SDL_Surface *result = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (result && SDL_SoftStretchLinear(current, NULL, result, NULL) != 0) {
+        SDL_FreeSurface(result);
+        result = NULL;
+    }
+    if (current != source) SDL_FreeSurface(current);
+    return result;
+}
+
+// Lays out every orientation of every sprite at tileSize: column i holds
+// sprite i and row r holds CELL_ORIENTATION r, so any board draw is a
+// plain axis-aligned copy of one tile. Only reads the atlas sources, so it
+// may run on any thread.
+SDL_Surface *buildSpriteSheet(const SpriteAtlas *atlas, int tileSize) {
+    SDL_Surface *sheet = SDL_CreateRGBSurfaceWithFormat(0, tileSize * SPRITE_COUNT, tileSize * CELL_ORIENTATIONS, 32, SDL_PIXELFORMAT_ARGB8888);
+    uint32_t *variant = malloc(sizeof(uint32_t) * tileSize * tileSize);
+    bool ok = sheet && variant;
+    for (int i = 0; i < SPRITE_COUNT && ok; i++) {
+        SDL_Surface *tile = resampleSurface(atlas->sources[i], tileSize, tileSize);
+        ok = tile && tile->pitch == tileSize * 4;
+        for (int orientation = 0; orientation < CELL_ORIENTATIONS && ok; orientation++) {
+            rotateCellTile(variant, tile->pixels, tileSize, orientation);
+            for (int y = 0; y < tileSize; y++) {
+                Uint8 *row = (Uint8 *)sheet->pixels + (size_t)(orientation * tileSize + y) * sheet->pitch;
+                memcpy(row + (size_t)i * tileSize * 4, variant + (size_t)y * tileSize, (size_t)tileSize * 4);
+            }
+        }
+        SDL_FreeSurface(tile);
+    }
+    free(variant);
+    if (!ok) {
+        SDL_FreeSurface(sheet);
+        return NULL;
+    }
+    return sheet;
+}
+
+// Uploads a sheet from buildSpriteSheet() and takes ownership of it. On
+// failure the previous sheet stays in use.
+bool useSpriteSheet(SpriteAtlas *atlas, SDL_Renderer *renderer, SDL_Surface *sheet, int tileSize) {
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, sheet);
+    if (!texture) {
+        printf("Unable to upload sprite sheet! SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(sheet);
+        return false;
+    }
+    if (atlas->texture) SDL_DestroyTexture(atlas->texture);
+    SDL_FreeSurface(atlas->surface);
+    atlas->texture = texture;
+    atlas->surface = sheet;
+    atlas->tileSize = tileSize;
+    return true;
+}
+
+// Two triangles per quad of four vertices, as SDL_RenderGeometry expects.
+void fillQuadIndices(int *indices, int quads) {
+    static const int quad[6] = {0, 1, 2, 2, 1, 3};
+    for (int i = 0; i < quads; i++) {
+        for (int j = 0; j < 6; j++) {
+            indices[i * 6 + j] = i * 4 + quad[j];
+        }
+    }
+}
+
+// Takes ownership of the decoded ARGB8888 sprites, even on failure, and
+// keeps them so the sheet can be rebuilt at another tile size without
+// decoding again.
+bool createSpriteAtlas(SpriteAtlas *atlas, SDL_Renderer *renderer, SDL_Surface *sources[SPRITE_COUNT], int capacity) {
+    memset(atlas, 0, sizeof(*atlas));
+    memcpy(atlas->sources, sources, sizeof(atlas->sources));
+    Uint64 start = SDL_GetPerformanceCounter();
+    int size = 0;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        if (atlas->sources[i]->w > size) size = atlas->sources[i]->w;
+        if (atlas->sources[i]->h > size) size = atlas->sources[i]->h;
+    }
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        for (int orientation = 0; orientation < CELL_ORIENTATIONS; orientation++) {
+            atlas->uv[i][orientation] = (SDL_FRect){(float)i / SPRITE_COUNT, (float)orientation / CELL_ORIENTATIONS,
+                                                    1.0f / SPRITE_COUNT, 1.0f / CELL_ORIENTATIONS};
+        }
+    }
+    SDL_Surface *sheet = buildSpriteSheet(atlas, size);
+    if (!sheet) {
+        printf("Unable to create sprite atlas! SDL Error: %s\n", SDL_GetError());
+        destroySpriteAtlas(atlas);
+        return false;
+    }
+    if (!useSpriteSheet(atlas, renderer, sheet, size)) {
+        destroySpriteAtlas(atlas);
+        return false;
+    }
+    atlas->buildTime = SDL_GetPerformanceCounter() - start;
+
+    atlas->capacity = capacity;
+    atlas->vertices = malloc(sizeof(SDL_Vertex) * 4 * capacity);
+    atlas->indices = malloc(sizeof(int) * 6 * capacity);
+    if (!atlas->vertices || !atlas->indices) {
+        printf("Unable to allocate sprite batch!\n");
+        destroySpriteAtlas(atlas);
+        return false;
+    }
+    fillQuadIndices(atlas->indices, capacity);
+    return true;
+}
+
+void destroySpriteAtlas(SpriteAtlas *atlas) {
+    if (atlas->texture) SDL_DestroyTexture(atlas->texture);
+    SDL_FreeSurface(atlas->surface);
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        SDL_FreeSurface(atlas->sources[i]);
+    }
+    cellBlitterFree(&atlas->blitter);
+    free(atlas->vertices);
+    free(atlas->indices);
+    free(atlas->blits);
+    memset(atlas, 0, sizeof(*atlas));
+}
+
+// Routes every later sprite to the CPU blitter, drawing into target instead
+// of through the renderer. Sprites are scaled to cellSize once here, and
+// every queued destination rect must be cellSize square.
+bool useCpuBlitter(SpriteAtlas *atlas, SDL_Surface *target, int cellSize, int threads) {
+    if (target->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        printf("CPU blitter needs an ARGB8888 target!\n");
+        return false;
+    }
+    // One sprite under another, so each tile's pixels are contiguous
+    SDL_Surface *strip = SDL_CreateRGBSurfaceWithFormat(0, cellSize, cellSize * SPRITE_COUNT, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!strip || strip->pitch != cellSize * 4) {
+        printf("Unable to create CPU blitter tiles! SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(strip);
+        return false;
+    }
+    SDL_SetSurfaceBlendMode(atlas->surface, SDL_BLENDMODE_NONE);
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        SDL_Rect source = {i * atlas->tileSize, 0, atlas->tileSize, atlas->tileSize};
+        SDL_Rect tile = {0, i * cellSize, cellSize, cellSize};
+        SDL_BlitScaled(atlas->surface, &source, strip, &tile);
+    }
+    bool ok = cellBlitterInit(&atlas->blitter, strip->pixels, SPRITE_COUNT, cellSize, threads);
+    SDL_FreeSurface(strip);
+    atlas->blits = ok ? malloc(sizeof(CellBlit) * atlas->capacity) : NULL;
+    if (!atlas->blits) {
+        printf("Unable to allocate CPU blitter!\n");
+        cellBlitterFree(&atlas->blitter);
+        return false;
+    }
+    atlas->blitTarget = target;
+    return true;
+}
+
+// Writes the four vertices of one quad in the same corner order as the
+// atlas index buffer. Touches no shared state, so any thread may call it.
+void writeSpriteQuad(const SpriteAtlas *atlas, SDL_Vertex *vertex, SpriteId sprite, int orientation, const SDL_FRect *dest) {
+    const SDL_FRect *uv = &atlas->uv[sprite][orientation];
+    SDL_Color white = {255, 255, 255, 255};
+    float left = uv->x;
+    float top = uv->y;
+    float right = uv->x + uv->w;
+    float bottom = uv->y + uv->h;
+    vertex[0] = (SDL_Vertex){{dest->x, dest->y}, white, {left, top}};
+    vertex[1] = (SDL_Vertex){{dest->x + dest->w, dest->y}, white, {right, top}};
+    vertex[2] = (SDL_Vertex){{dest->x, dest->y + dest->h}, white, {left, bottom}};
+    vertex[3] = (SDL_Vertex){{dest->x + dest->w, dest->y + dest->h}, white, {right, bottom}};
+}
+
+// Same meaning as SDL_RenderCopyEx with a multiple of 90 degrees: the
+// pre-rotated variant is picked and copied without any transform.
+void queueSprite(SpriteAtlas *atlas, SDL_Renderer *renderer, SpriteId sprite, const SDL_FRect *dest, double angle, SDL_RendererFlip flip) {
+    if (atlas->count == atlas->capacity) {
+        flushSprites(atlas, renderer);
+    }
+    // A horizontal flip is a half turn followed by a vertical flip
+    int turns = ((int)(angle / 90.0) % 4 + 4) % 4;
+    bool flipped = flip & SDL_FLIP_VERTICAL;
+    if (flip & SDL_FLIP_HORIZONTAL) {
+        turns = (turns + 2) % 4;
+        flipped = !flipped;
+    }
+    int orientation = CELL_ORIENTATION(turns, flipped);
+    if (atlas->blitTarget) {
+        atlas->blits[atlas->count++] = (CellBlit){sprite, orientation,
+                                                  (int)SDL_floorf(dest->x + 0.5f), (int)SDL_floorf(dest->y + 0.5f)};
+        return;
+    }
+    writeSpriteQuad(atlas, &atlas->vertices[atlas->count * 4], sprite, orientation, dest);
+    atlas->count++;
+}
+
+void flushSprites(SpriteAtlas *atlas, SDL_Renderer *renderer) {
+    if (atlas->count > 0 && atlas->blitTarget) {
+        // Earlier renderer commands must land before the CPU writes on top of them
+        SDL_RenderFlush(renderer);
+        SDL_Surface *target = atlas->blitTarget;
+        SDL_Rect viewport;
+        SDL_RenderGetViewport(renderer, &viewport);
+        SDL_LockSurface(target);
+        // Quads are relative to the viewport, just like on the renderer path
+        uint32_t *origin = (uint32_t *)target->pixels + (size_t)viewport.y * (target->pitch / 4) + viewport.x;
+        cellBlitterDraw(&atlas->blitter, origin, viewport.w, viewport.h, target->pitch / 4, atlas->blits, atlas->count);
+        SDL_UnlockSurface(target);
+        atlas->count = 0;
+    } else if (atlas->count > 0) {
+        SDL_RenderGeometry(renderer, atlas->texture, atlas->vertices, atlas->count * 4, atlas->indices, atlas->count * 6);
+        atlas->count = 0;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "cell_blitter.h"
+
+typedef enum {
+    SPRITE_HEAD,
+    SPRITE_BODY,
+    SPRITE_TAIL,
+    SPRITE_TURN,
+    SPRITE_APPLE,
+    SPRITE_COUNT
+} SpriteId;
+
+// All board sprites in all eight orientations packed into one texture, plus
+// a vertex/index buffer so a whole frame of sprites goes out as a single
+// SDL_RenderGeometry call.
+typedef struct {
+    SDL_Texture *texture;
+    int tileSize;               // pixels per tile of the current sheet
+    Uint64 buildTime;           // performance counter ticks createSpriteAtlas() spent on the first sheet
+    SDL_Surface *sources[SPRITE_COUNT]; // decoded sprites, ARGB8888
+    SDL_FRect uv[SPRITE_COUNT][CELL_ORIENTATIONS]; // normalized source rect of every variant
+    SDL_Vertex *vertices;
+    int *indices;
+    int capacity;               // sprites per batch
+    int count;                  // sprites queued since the last flush
+    SDL_Surface *surface;       // the current sheet, kept to build CPU blitter tiles from
+    SDL_Surface *blitTarget;    // when set, sprites are blended into it on the CPU instead
+    CellBlitter blitter;
+    CellBlit *blits;
+} SpriteAtlas;
+
+SDL_Surface *resampleSurface(SDL_Surface *source, int width, int height);
+SDL_Surface *buildSpriteSheet(const SpriteAtlas *atlas, int tileSize);
+bool useSpriteSheet(SpriteAtlas *atlas, SDL_Renderer *renderer, SDL_Surface *sheet, int tileSize);
+bool createSpriteAtlas(SpriteAtlas *atlas, SDL_Renderer *renderer, SDL_Surface *sources[SPRITE_COUNT], int capacity);
+void destroySpriteAtlas(SpriteAtlas *atlas);
+bool useCpuBlitter(SpriteAtlas *atlas, SDL_Surface *target, int cellSize, int threads);
+void fillQuadIndices(int *indices, int quads);
+void writeSpriteQuad(const SpriteAtlas *atlas, SDL_Vertex *vertex, SpriteId sprite, int orientation, const SDL_FRect *dest);
+void queueSprite(SpriteAtlas *atlas, SDL_Renderer *renderer, SpriteId sprite, const SDL_FRect *dest, double angle, SDL_RendererFlip flip);
+void flushSprites(SpriteAtlas *atlas, SDL_Renderer *renderer);
+
+#endif // SPRITE_ATLAS_H
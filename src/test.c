@@ -0,0 +1,283 @@
+#include "snake_batch.h"
+#include "cell_blitter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Differential checks of the optimized paths against plain reference code.
+// Needs nothing but the core library; exits non-zero if any check fails.
+
+static int failures;
+
+#define CHECK(condition, ...)              \
+    do {                                   \
+        if (!(condition)) {                \
+            if (failures++ < 20) {         \
+                printf(__VA_ARGS__);       \
+                printf("\n");              \
+            }                              \
+        }                                  \
+    } while (0)
+
+#define TEST_BATCH_GAMES 37  // not a multiple of SNAKE_BATCH_LANES, so padding lanes are exercised
+#define TEST_BATCH_TICKS 20000
+
+// Steps a SnakeBatch with the given kernel next to independent SnakeStates
+// fed the same random turns and resets, comparing every game every tick.
+static void testBatchKernel(SnakeKernel kernel, int width, int height) {
+    SnakeBatch batch;
+    SnakeState games[TEST_BATCH_GAMES];
+    uint64_t seed = 1234;
+    if (!snakeBatchInit(&batch, TEST_BATCH_GAMES, width, height, seed)) {
+        CHECK(false, "batch: init failed");
+        return;
+    }
+    batch.kernel = kernel;
+    for (int i = 0; i < TEST_BATCH_GAMES; i++) {
+        snakeInit(&games[i], width, height, seed + (uint64_t)i);
+    }
+    uint64_t rng = 99;
+    uint64_t nextSeed = 5000;
+    int results[TEST_BATCH_GAMES];
+    for (int tick = 0; tick < TEST_BATCH_TICKS; tick++) {
+        for (int i = 0; i < TEST_BATCH_GAMES; i++) {
+            // Mostly keep going, so games live long enough to eat and wrap
+            if (snakeRandomStream(&rng, 3) == 0) {
+                Direction turn = (Direction)snakeRandomStream(&rng, 4);
+                bool turned = snakeTurn(&games[i], turn);
+                CHECK(snakeBatchTurn(&batch, i, turn) == turned, "batch kernel %d: turn differs, game %d tick %d", kernel, i, tick);
+            }
+        }
+        snakeBatchStep(&batch, results);
+        for (int i = 0; i < TEST_BATCH_GAMES; i++) {
+            SnakeState *game = &games[i];
+            int expected = snakeStep(game);
+            Point head = snakeSegment(game, 0);
+            CHECK(results[i] == expected, "batch kernel %d: flags %d != %d, game %d tick %d", kernel, results[i], expected, i, tick);
+            CHECK(batch.headX[i] == head.x && batch.headY[i] == head.y, "batch kernel %d: head differs, game %d tick %d", kernel, i, tick);
+            CHECK(batch.score[i] == game->score, "batch kernel %d: score differs, game %d tick %d", kernel, i, tick);
+            CHECK(batch.status[i] == (int32_t)game->status, "batch kernel %d: status differs, game %d tick %d", kernel, i, tick);
+            CHECK(game->status == SNAKE_WON || batch.foodCell[i] == game->food.y * width + game->food.x,
+                  "batch kernel %d: food differs, game %d tick %d", kernel, i, tick);
+            if (game->status != SNAKE_ALIVE) {
+                snakeReset(game, nextSeed);
+                snakeBatchReset(&batch, i, nextSeed);
+                nextSeed++;
+            }
+        }
+    }
+    for (int i = 0; i < TEST_BATCH_GAMES; i++) {
+        snakeFree(&games[i]);
+    }
+    snakeBatchFree(&batch);
+}
+
+static void testBatch(void) {
+    static const char *names[] = {"scalar", "SSE4.1", "AVX2"};
+    SnakeKernel best = snakeBatchBestKernel();
+    for (SnakeKernel kernel = SNAKE_KERNEL_SCALAR; kernel <= best; kernel++) {
+        int before = failures;
+        testBatchKernel(kernel, 11, 7);
+        testBatchKernel(kernel, 40, 33);
+        printf("batch %s kernel: %s\n", names[kernel], failures == before ? "ok" : "FAILED");
+    }
+}
+
+// Offset of neighbour from cell along one axis, with a step across the edge
+// folded back to -1 or 1, so the old comparisons see adjacent cells.
+static int unwrap(int neighbour, int cell, int size) {
+    int offset = neighbour - cell;
+    if (offset > 1) offset -= size;
+    if (offset < -1) offset += size;
+    return cell + offset;
+}
+
+// The orientation rules render() used before codes were kept in the core,
+// translated from pixels to cells. ahead is the segment towards the head,
+// behind the one towards the tail. The old head and tail rules handled the
+// wrap-around themselves; the body and turn rules only compared coordinates,
+// so their neighbours are unwrapped first.
+static uint8_t oldHeadCode(Direction direction) {
+    static const int angles[4] = {[UP] = 270, [DOWN] = 90, [RIGHT] = 0, [LEFT] = 180};
+    return SEGMENT_CODE(SEGMENT_HEAD, angles[direction] / 90, 0);
+}
+
+static uint8_t oldTailCode(Point ahead, Point tail, int width, int height) {
+    int angle = 0;
+    if (ahead.x == width - 1 && tail.x == 0) angle = 180;
+    else if (ahead.x == 0 && tail.x == width - 1) angle = 0;
+    else if (ahead.y == height - 1 && tail.y == 0) angle = 270;
+    else if (ahead.y == 0 && tail.y == height - 1) angle = 90;
+    else if (ahead.x < tail.x) angle = 180;
+    else if (ahead.x > tail.x) angle = 0;
+    else if (ahead.y < tail.y) angle = 270;
+    else if (ahead.y > tail.y) angle = 90;
+    return SEGMENT_CODE(SEGMENT_TAIL, angle / 90, 0);
+}
+
+static uint8_t oldBodyCode(Point ahead, Point cell, Point behind, int width, int height) {
+    Point prev = {unwrap(ahead.x, cell.x, width), unwrap(ahead.y, cell.y, height)};
+    Point next = {unwrap(behind.x, cell.x, width), unwrap(behind.y, cell.y, height)};
+    if (prev.x == next.x || prev.y == next.y) {
+        return SEGMENT_CODE(SEGMENT_BODY, prev.x != cell.x ? 0 : 1, 0);
+    }
+    int angle = 0;
+    int flip = 0;
+    if (prev.y < cell.y && next.x < cell.x) { angle = 270; flip = 1; }
+    else if (prev.y > cell.y && next.x < cell.x) { angle = 90; flip = 0; }
+    else if (prev.y < cell.y && next.x > cell.x) { angle = 270; flip = 0; }
+    else if (prev.y > cell.y && next.x > cell.x) { angle = 90; flip = 1; }
+    else if (prev.x < cell.x && next.y < cell.y) { angle = 180; flip = 0; }
+    else if (prev.x < cell.x && next.y > cell.y) { angle = 180; flip = 1; }
+    else if (prev.x > cell.x && next.y < cell.y) { angle = 0; flip = 1; }
+    else if (prev.x > cell.x && next.y > cell.y) { angle = 0; flip = 0; }
+    return SEGMENT_CODE(SEGMENT_TURN, angle / 90, flip);
+}
+
+// Every (in, out) pair on every cell of a small board, edges included,
+// then the codes the core keeps while random games wrap around the board.
+static void testSegmentCodes(void) {
+    int before = failures;
+    const int width = 5;
+    const int height = 4;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            Point cell = {x, y};
+            for (Direction in = UP; in <= LEFT; in++) {
+                for (Direction out = UP; out <= LEFT; out++) {
+                    if ((out + 2) % 4 == in) {
+                        continue;
+                    }
+                    Point behind = snakeNeighbour(cell, (Direction)((in + 2) % 4), width, height);
+                    Point ahead = snakeNeighbour(cell, out, width, height);
+                    CHECK(snakeBodyCode(in, out) == oldBodyCode(ahead, cell, behind, width, height),
+                          "codes: in %d out %d at (%d,%d) differs", in, out, x, y);
+                }
+            }
+        }
+    }
+
+    SnakeState game;
+    snakeInit(&game, width, height, 7);
+    uint64_t rng = 3;
+    for (int tick = 0; tick < 200000; tick++) {
+        if (snakeRandomStream(&rng, 2) == 0) {
+            snakeTurn(&game, (Direction)snakeRandomStream(&rng, 4));
+        }
+        snakeStep(&game);
+        if (game.status != SNAKE_ALIVE) {
+            snakeReset(&game, (uint64_t)tick);
+            continue;
+        }
+        int last = game.length - 1;
+        CHECK(snakeSegmentCode(&game, 0) == oldHeadCode(game.direction), "codes: head differs at tick %d", tick);
+        CHECK(snakeSegmentCode(&game, last) == oldTailCode(snakeSegment(&game, last - 1), snakeSegment(&game, last), width, height),
+              "codes: tail differs at tick %d", tick);
+        for (int i = 1; i < last; i++) {
+            CHECK(snakeSegmentCode(&game, i) == oldBodyCode(snakeSegment(&game, i - 1), snakeSegment(&game, i),
+                                                            snakeSegment(&game, i + 1), width, height),
+                  "codes: segment %d differs at tick %d", i, tick);
+        }
+    }
+    snakeFree(&game);
+    printf("segment codes: %s\n", failures == before ? "ok" : "FAILED");
+}
+
+#define TEST_TILE 13          // odd, so rows end off every vector width
+#define TEST_SPRITES 3
+#define TEST_FRAME_WIDTH 97
+#define TEST_FRAME_HEIGHT 61
+#define TEST_FRAME_PITCH 101  // padding columns must stay untouched
+#define TEST_BLITS 400
+
+// Source-over with exact rounding of x / 255, written the obvious way.
+static uint32_t referenceBlend(uint32_t src, uint32_t dst) {
+    uint32_t alpha = src >> 24;
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t s = shift == 24 ? 255 : (src >> shift) & 0xFF;
+        uint32_t d = (dst >> shift) & 0xFF;
+        uint32_t t = s * alpha + d * (255 - alpha);
+        out |= ((2 * t + 255) / 510) << shift;
+    }
+    return out;
+}
+
+static void referenceBlits(uint32_t *frame, const uint32_t *sprites, const CellBlit *blits, int count) {
+    uint32_t tile[TEST_TILE * TEST_TILE];
+    for (int i = 0; i < count; i++) {
+        const CellBlit *blit = &blits[i];
+        rotateCellTile(tile, sprites + (size_t)blit->sprite * TEST_TILE * TEST_TILE, TEST_TILE, blit->orientation);
+        for (int y = 0; y < TEST_TILE; y++) {
+            for (int x = 0; x < TEST_TILE; x++) {
+                int fx = blit->x + x;
+                int fy = blit->y + y;
+                if (fx >= 0 && fx < TEST_FRAME_WIDTH && fy >= 0 && fy < TEST_FRAME_HEIGHT) {
+                    uint32_t *pixel = &frame[fy * TEST_FRAME_PITCH + fx];
+                    *pixel = referenceBlend(tile[y * TEST_TILE + x], *pixel);
+                }
+            }
+        }
+    }
+}
+
+// Every kernel the CPU supports at 1 to 4 row bands must match the
+// reference bit for bit, including clipped blits and fully transparent
+// and opaque texels.
+static void testCellBlitter(void) {
+    static const char *names[] = {"scalar", "SSE4.1", "AVX2"};
+    uint64_t rng = 11;
+    uint32_t sprites[TEST_SPRITES * TEST_TILE * TEST_TILE];
+    for (int i = 0; i < TEST_SPRITES * TEST_TILE * TEST_TILE; i++) {
+        uint32_t alpha = snakeRandomStream(&rng, 4) == 0 ? 0 : snakeRandomStream(&rng, 4) == 0 ? 255 : snakeRandomStream(&rng, 256);
+        sprites[i] = alpha << 24 | snakeRandomStream(&rng, 1u << 24);
+    }
+    CellBlit blits[TEST_BLITS];
+    for (int i = 0; i < TEST_BLITS; i++) {
+        blits[i] = (CellBlit){(int)snakeRandomStream(&rng, TEST_SPRITES), (int)snakeRandomStream(&rng, CELL_ORIENTATIONS),
+                              (int)snakeRandomStream(&rng, TEST_FRAME_WIDTH + TEST_TILE) - TEST_TILE,
+                              (int)snakeRandomStream(&rng, TEST_FRAME_HEIGHT + TEST_TILE) - TEST_TILE};
+    }
+    static uint32_t background[TEST_FRAME_PITCH * TEST_FRAME_HEIGHT];
+    static uint32_t expected[TEST_FRAME_PITCH * TEST_FRAME_HEIGHT];
+    static uint32_t frame[TEST_FRAME_PITCH * TEST_FRAME_HEIGHT];
+    for (int i = 0; i < TEST_FRAME_PITCH * TEST_FRAME_HEIGHT; i++) {
+        background[i] = snakeRandomStream(&rng, UINT32_MAX);
+    }
+    memcpy(expected, background, sizeof(expected));
+    referenceBlits(expected, sprites, blits, TEST_BLITS);
+
+    BlitKernel best = cellBlitterBestKernel();
+    for (BlitKernel kernel = BLIT_KERNEL_SCALAR; kernel <= best; kernel++) {
+        int before = failures;
+        for (int bands = 1; bands <= 4; bands++) {
+            CellBlitter blitter;
+            if (!cellBlitterInit(&blitter, sprites, TEST_SPRITES, TEST_TILE, bands)) {
+                CHECK(false, "blitter: init failed");
+                continue;
+            }
+            blitter.kernel = kernel;
+            memcpy(frame, background, sizeof(frame));
+            cellBlitterDraw(&blitter, frame, TEST_FRAME_WIDTH, TEST_FRAME_HEIGHT, TEST_FRAME_PITCH, blits, TEST_BLITS);
+            int wrong = 0;
+            for (int i = 0; i < TEST_FRAME_PITCH * TEST_FRAME_HEIGHT; i++) {
+                wrong += frame[i] != expected[i];
+            }
+            CHECK(wrong == 0, "blitter %s kernel, %d bands: %d pixels differ", names[kernel], bands, wrong);
+            cellBlitterFree(&blitter);
+        }
+        printf("blitter %s kernel: %s\n", names[kernel], failures == before ? "ok" : "FAILED");
+    }
+}
+
+int main(void) {
+    testBatch();
+    testSegmentCodes();
+    testCellBlitter();
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
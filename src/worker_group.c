@@ -0,0 +1,100 @@
+#include "worker_group.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void *workerMain(void *arg) {
+    WorkerThread *worker = arg;
+    WorkerGroup *group = worker->group;
+    int seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&group->lock);
+        while (!group->quit && group->generation == seen) {
+            pthread_cond_wait(&group->wake, &group->lock);
+        }
+        if (group->quit) {
+            pthread_mutex_unlock(&group->lock);
+            return NULL;
+        }
+        seen = group->generation;
+        pthread_mutex_unlock(&group->lock);
+
+        group->job(group->context, worker->index);
+
+        pthread_mutex_lock(&group->lock);
+        if (++group->finished == group->count - 1) {
+            pthread_cond_signal(&group->done);
+        }
+        pthread_mutex_unlock(&group->lock);
+    }
+}
+
+// count < 1 is treated as 1. On failure the group is left freed.
+bool workerGroupInit(WorkerGroup *group, int count, WorkerJob job, void *context) {
+    memset(group, 0, sizeof(*group));
+    group->count = count > 1 ? count : 1;
+    group->job = job;
+    group->context = context;
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->wake, NULL);
+    pthread_cond_init(&group->done, NULL);
+    if (group->count == 1) {
+        return true;
+    }
+    group->threads = calloc(group->count - 1, sizeof(WorkerThread));
+    if (!group->threads) {
+        group->count = 1;
+        workerGroupFree(group);
+        return false;
+    }
+    for (int i = 0; i < group->count - 1; i++) {
+        WorkerThread *worker = &group->threads[i];
+        worker->group = group;
+        worker->index = i + 1;
+        if (pthread_create(&worker->thread, NULL, workerMain, worker) != 0) {
+            group->count = i + 1;
+            workerGroupFree(group);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Safe on a zeroed or already freed group.
+void workerGroupFree(WorkerGroup *group) {
+    if (!group->job) {
+        return;
+    }
+    pthread_mutex_lock(&group->lock);
+    group->quit = true;
+    pthread_cond_broadcast(&group->wake);
+    pthread_mutex_unlock(&group->lock);
+    for (int i = 0; i < group->count - 1; i++) {
+        pthread_join(group->threads[i].thread, NULL);
+    }
+    pthread_cond_destroy(&group->done);
+    pthread_cond_destroy(&group->wake);
+    pthread_mutex_destroy(&group->lock);
+    free(group->threads);
+    memset(group, 0, sizeof(*group));
+}
+
+// Runs the job on every worker and returns once all of them are done.
+void workerGroupRun(WorkerGroup *group) {
+    if (group->count == 1) {
+        group->job(group->context, 0);
+        return;
+    }
+    pthread_mutex_lock(&group->lock);
+    group->finished = 0;
+    group->generation++;
+    pthread_cond_broadcast(&group->wake);
+    pthread_mutex_unlock(&group->lock);
+
+    group->job(group->context, 0);
+
+    pthread_mutex_lock(&group->lock);
+    while (group->finished < group->count - 1) {
+        pthread_cond_wait(&group->done, &group->lock);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
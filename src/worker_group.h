@@ -0,0 +1,38 @@
+#ifndef WORKER_GROUP_H
+#define WORKER_GROUP_H
+
+// A fixed set of threads that all run the same job once per
+// workerGroupRun(). The caller runs as worker 0, so a group of one starts
+// no threads. Per-run inputs live in the job's context, set before the run.
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef void (*WorkerJob)(void *context, int worker);
+
+typedef struct WorkerGroup WorkerGroup;
+
+typedef struct {
+    WorkerGroup *group;
+    int index;
+    pthread_t thread;
+} WorkerThread;
+
+struct WorkerGroup {
+    int count;           // workers including the caller
+    WorkerJob job;
+    void *context;
+    WorkerThread *threads; // workers 1 to count - 1
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int generation;
+    int finished;
+    bool quit;
+};
+
+bool workerGroupInit(WorkerGroup *group, int count, WorkerJob job, void *context);
+void workerGroupFree(WorkerGroup *group);
+void workerGroupRun(WorkerGroup *group);
+
+#endif // WORKER_GROUP_H